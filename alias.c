@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <assert.h>
+
+#include "alias.h"
+#include "rng.h"
+
+struct alias
+{
+    int n;
+    double *prob; /* 落在第 i 列时取 i 的概率, 否则取 alias[i] */
+    int *alias;
+};
+
+struct alias *alias_create(const double *weights, int n)
+{
+    if (n <= 0)
+    {
+        return NULL;
+    }
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (weights[i] < 0)
+        {
+            return NULL;
+        }
+        sum += weights[i];
+    }
+    if (sum <= 0)
+    {
+        return NULL;
+    }
+
+    struct alias *a = calloc(1, sizeof(*a));
+    assert(a);
+    a->n = n;
+    a->prob = calloc(n, sizeof(*a->prob));
+    a->alias = calloc(n, sizeof(*a->alias));
+    assert(a->prob && a->alias);
+
+    // 归一化到平均值 1, 小于 1 的列由大于 1 的列补齐
+    double *scaled = malloc(n * sizeof(*scaled));
+    int *small = malloc(n * sizeof(*small));
+    int *large = malloc(n * sizeof(*large));
+    assert(scaled && small && large);
+    int small_n = 0;
+    int large_n = 0;
+    for (int i = 0; i < n; i++)
+    {
+        scaled[i] = weights[i] * n / sum;
+        if (scaled[i] < 1)
+        {
+            small[small_n++] = i;
+        }
+        else
+        {
+            large[large_n++] = i;
+        }
+    }
+
+    while (small_n > 0 && large_n > 0)
+    {
+        int s = small[--small_n];
+        int l = large[--large_n];
+        a->prob[s] = scaled[s];
+        a->alias[s] = l;
+        scaled[l] = (scaled[l] + scaled[s]) - 1;
+        if (scaled[l] < 1)
+        {
+            small[small_n++] = l;
+        }
+        else
+        {
+            large[large_n++] = l;
+        }
+    }
+    // 剩余列因浮点误差接近 1, 直接取自身
+    while (large_n > 0)
+    {
+        int l = large[--large_n];
+        a->prob[l] = 1;
+        a->alias[l] = l;
+    }
+    while (small_n > 0)
+    {
+        int s = small[--small_n];
+        a->prob[s] = 1;
+        a->alias[s] = s;
+    }
+
+    free(scaled);
+    free(small);
+    free(large);
+    return a;
+}
+
+void alias_release(struct alias *a)
+{
+    free(a->prob);
+    free(a->alias);
+    free(a);
+}
+
+int alias_sample(const struct alias *a, uint64_t *rng)
+{
+    uint32_t i = rng_below(rng, a->n);
+    return rng_double(rng) < a->prob[i] ? (int)i : a->alias[i];
+}
@@ -0,0 +1,17 @@
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include <stdint.h>
+
+// Walker/Vose alias 方法按权重抽样, 建表 O(n), 每次抽样 O(1)
+// 建表后只读, 可多线程共享, 随机数状态由调用方持有
+
+struct alias;
+
+// 权重须非负且和大于 0, 否则返回 NULL
+struct alias *alias_create(const double *weights, int n);
+void alias_release(struct alias *);
+
+int alias_sample(const struct alias *, uint64_t *rng);
+
+#endif
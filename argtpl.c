@@ -0,0 +1,543 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <assert.h>
+#include <inttypes.h>
+
+#include "argtpl.h"
+#include "dubbo_hessian.h"
+#include "log.h"
+
+#define ARGTPL_ZETA_EXACT_N 1000000
+#define ARGTPL_HOTSPOT_DEFAULT_N 1000000
+
+enum seg_type
+{
+    SEG_LITERAL,
+    SEG_FIELD,
+    SEG_ZIPF,
+    SEG_UNIFORM,
+    SEG_HOTSPOT,
+    SEG_SEQ,
+};
+
+// Gray et al. "Quickly Generating Billion-Record Synthetic Databases" 的 zipf 采样, 常量预先计算
+struct zipf
+{
+    int64_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+    double half_pow_theta; /* 1 + 0.5^theta */
+};
+
+struct seg
+{
+    enum seg_type type;
+    bool in_str; /* 位于 JSON 字符串内 */
+
+    // SEG_LITERAL
+    const char *p;
+    size_t len;
+
+    // SEG_FIELD: CSV 与 JSONL 数组按 col, JSONL 对象按 name
+    int col;
+    char *name;
+
+    // SEG_UNIFORM: [lo, hi]; SEG_HOTSPOT: 热点 [lo, hot_n], 其余 (hot_n, hi]; SEG_SEQ: 起始值 lo
+    int64_t lo;
+    int64_t hi;
+    int64_t hot_n;
+    double hot_p;
+    struct zipf zipf;
+};
+
+struct argtpl
+{
+    const struct dataset *ds;
+    char *text;
+    struct seg *segs;
+    int seg_n;
+    int field_n;
+    int gen_n;
+};
+
+static struct seg *argtpl_push(struct argtpl *tpl, enum seg_type type, bool in_str)
+{
+    tpl->segs = realloc(tpl->segs, (tpl->seg_n + 1) * sizeof(*tpl->segs));
+    assert(tpl->segs);
+    struct seg *s = &tpl->segs[tpl->seg_n++];
+    memset(s, 0, sizeof(*s));
+    s->type = type;
+    s->in_str = in_str;
+    s->col = -1;
+    return s;
+}
+
+static bool argtpl_field(struct argtpl *tpl, struct seg *s, const char *name, size_t len)
+{
+    if (tpl->ds == NULL)
+    {
+        LOG_ERROR("参数模板引用了 {{$%.*s}}, 但未指定数据集 (--dataset)", (int)len, name);
+        return false;
+    }
+
+    size_t i = 0;
+    while (i < len && isdigit((unsigned char)name[i]))
+    {
+        i++;
+    }
+    if (i == len)
+    {
+        s->col = atoi(name) - 1;
+        if (s->col < 0)
+        {
+            LOG_ERROR("参数模板列号从 1 开始: {{$%.*s}}", (int)len, name);
+            return false;
+        }
+        return true;
+    }
+
+    s->name = strndup(name, len);
+    if (dataset_format(tpl->ds) == DATASET_CSV)
+    {
+        s->col = dataset_column(tpl->ds, s->name);
+        if (s->col < 0)
+        {
+            LOG_ERROR("数据集中没有列 %s", s->name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 1..n 的 i^-theta 之和; n 较大时超出部分以积分近似, 避免 O(n) 预计算
+static double zeta(int64_t n, double theta)
+{
+    int64_t exact = n < ARGTPL_ZETA_EXACT_N ? n : ARGTPL_ZETA_EXACT_N;
+    double sum = 0;
+    for (int64_t i = 1; i <= exact; i++)
+    {
+        sum += pow((double)i, -theta);
+    }
+    if (n > exact)
+    {
+        sum += (pow(n + 0.5, 1 - theta) - pow(exact + 0.5, 1 - theta)) / (1 - theta);
+    }
+    return sum;
+}
+
+static void zipf_init(struct zipf *z, int64_t n, double theta)
+{
+    z->n = n;
+    z->theta = theta;
+    z->alpha = 1 / (1 - theta);
+    z->zetan = zeta(n, theta);
+    z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta(2, theta) / z->zetan);
+    z->half_pow_theta = 1 + pow(0.5, theta);
+}
+
+static int64_t zipf_next(const struct zipf *z, uint64_t *rng)
+{
+    double u = rng_double(rng);
+    double uz = u * z->zetan;
+    if (uz < 1)
+    {
+        return 1;
+    }
+    if (uz < z->half_pow_theta)
+    {
+        return 2;
+    }
+    int64_t v = 1 + (int64_t)(z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+    return v > z->n ? z->n : v;
+}
+
+// [0, n), n 可超过 32 位
+static inline uint64_t rng_below64(uint64_t *rng, uint64_t n)
+{
+    return (uint64_t)(((unsigned __int128)rng_next(rng) * n) >> 64);
+}
+
+// 解析 name:a:b... 中的数值参数, 返回个数, 非法返回 -1
+static int gen_params(const char *p, size_t len, double *vals, int cap)
+{
+    int n = 0;
+    const char *end = p + len;
+    while (p < end && *p == ':')
+    {
+        if (n == cap)
+        {
+            return -1;
+        }
+        char *e = NULL;
+        vals[n++] = strtod(p + 1, &e);
+        if (e == p + 1 || e > end)
+        {
+            return -1;
+        }
+        p = e;
+    }
+    return p == end ? n : -1;
+}
+
+static bool argtpl_gen(struct seg *s, const char *spec, size_t len)
+{
+    double v[3];
+    int n;
+    const char *colon = memchr(spec, ':', len);
+    size_t name_len = colon ? (size_t)(colon - spec) : len;
+
+#define GEN_IS(name) (name_len == strlen(name) && memcmp(spec, name, name_len) == 0)
+    if (GEN_IS("zipf"))
+    {
+        n = gen_params(spec + name_len, len - name_len, v, 2);
+        if (n != 2 || v[0] < 2 || v[1] <= 0 || v[1] >= 1)
+        {
+            goto invalid;
+        }
+        s->type = SEG_ZIPF;
+        zipf_init(&s->zipf, (int64_t)v[0], v[1]);
+    }
+    else if (GEN_IS("uniform"))
+    {
+        n = gen_params(spec + name_len, len - name_len, v, 2);
+        if (n != 2 || v[0] > v[1])
+        {
+            goto invalid;
+        }
+        s->type = SEG_UNIFORM;
+        s->lo = (int64_t)v[0];
+        s->hi = (int64_t)v[1];
+    }
+    else if (GEN_IS("hotspot"))
+    {
+        n = gen_params(spec + name_len, len - name_len, v, 3);
+        if (n < 2 || v[0] <= 0 || v[0] >= 1 || v[1] < 0 || v[1] > 1)
+        {
+            goto invalid;
+        }
+        s->type = SEG_HOTSPOT;
+        s->lo = 1;
+        s->hi = n == 3 ? (int64_t)v[2] : ARGTPL_HOTSPOT_DEFAULT_N;
+        s->hot_n = (int64_t)(s->hi * v[0]);
+        s->hot_p = v[1];
+        if (s->hot_n < 1 || s->hot_n >= s->hi)
+        {
+            goto invalid;
+        }
+    }
+    else if (GEN_IS("seq"))
+    {
+        n = gen_params(spec + name_len, len - name_len, v, 1);
+        if (n < 0)
+        {
+            goto invalid;
+        }
+        s->type = SEG_SEQ;
+        s->lo = n == 1 ? (int64_t)v[0] : 1;
+    }
+    else
+    {
+        LOG_ERROR("未知的参数模板占位符: {{%.*s}}", (int)len, spec);
+        return false;
+    }
+#undef GEN_IS
+    return true;
+
+invalid:
+    LOG_ERROR("参数模板占位符参数非法: {{%.*s}}", (int)len, spec);
+    return false;
+}
+
+struct argtpl *argtpl_compile(const char *text, const struct dataset *ds)
+{
+    struct argtpl *tpl = calloc(1, sizeof(*tpl));
+    assert(tpl);
+    tpl->ds = ds;
+    // 模板文本中的非 ASCII 字符预先转义, 字段在渲染时转义, 结果同静态参数
+    char *raw = strdup(text);
+    tpl->text = utf82ascii(raw);
+    free(raw);
+    if (tpl->text == NULL)
+    {
+        LOG_ERROR("参数模板不是合法的 UTF-8: %s", text);
+        free(tpl);
+        return NULL;
+    }
+
+    const char *p = tpl->text;
+    const char *lit = p;
+    bool in_str = false;
+    while (*p)
+    {
+        // {{$field}} 或 {{generator:...}}
+        if (p[0] == '{' && p[1] == '{' && (p[2] == '$' || isalpha((unsigned char)p[2])))
+        {
+            bool field = p[2] == '$';
+            const char *name = field ? p + 3 : p + 2;
+            const char *end = strstr(name, "}}");
+            if (end == NULL || end == name)
+            {
+                LOG_ERROR("参数模板占位符不完整: %s", p);
+                argtpl_release(tpl);
+                return NULL;
+            }
+            if (p > lit)
+            {
+                struct seg *s = argtpl_push(tpl, SEG_LITERAL, in_str);
+                s->p = lit;
+                s->len = p - lit;
+            }
+            struct seg *s = argtpl_push(tpl, SEG_FIELD, in_str);
+            if (field ? !argtpl_field(tpl, s, name, end - name) : !argtpl_gen(s, name, end - name))
+            {
+                argtpl_release(tpl);
+                return NULL;
+            }
+            if (field)
+            {
+                tpl->field_n++;
+            }
+            else
+            {
+                tpl->gen_n++;
+            }
+            p = lit = end + 2;
+            continue;
+        }
+        if (*p == '\\' && in_str && p[1])
+        {
+            p += 2;
+            continue;
+        }
+        if (*p == '"')
+        {
+            in_str = !in_str;
+        }
+        p++;
+    }
+    if (p > lit)
+    {
+        struct seg *s = argtpl_push(tpl, SEG_LITERAL, in_str);
+        s->p = lit;
+        s->len = p - lit;
+    }
+    return tpl;
+}
+
+void argtpl_release(struct argtpl *tpl)
+{
+    for (int i = 0; i < tpl->seg_n; i++)
+    {
+        free(tpl->segs[i].name);
+    }
+    free(tpl->segs);
+    free(tpl->text);
+    free(tpl);
+}
+
+bool argtpl_is_static(const struct argtpl *tpl)
+{
+    return tpl->field_n == 0 && tpl->gen_n == 0;
+}
+
+bool argtpl_uses_data(const struct argtpl *tpl)
+{
+    return tpl->field_n > 0;
+}
+
+static const char hex[] = "0123456789abcdef";
+
+static void append_u16(struct buffer *out, unsigned int c)
+{
+    char u[6] = {'\\', 'u', hex[(c >> 12) & 0xf], hex[(c >> 8) & 0xf], hex[(c >> 4) & 0xf], hex[c & 0xf]};
+    buf_append(out, u, sizeof(u));
+}
+
+// 一个非 ASCII 的 UTF-8 字符输出为 \uXXXX (BMP 以外为代理对), 同 utf82ascii; 非法字节输出为 \ufffd
+// 返回消耗的字节数
+static size_t append_utf8_escaped(struct buffer *out, const char *p, const char *end)
+{
+    const unsigned char *s = (const unsigned char *)p;
+    size_t n = s[0] >= 0xF0 ? 4 : s[0] >= 0xE0 ? 3 : s[0] >= 0xC0 ? 2 : 1;
+    unsigned int c = n == 4 ? s[0] & 0x07 : n == 3 ? s[0] & 0x0f : s[0] & 0x1f;
+    bool ok = n > 1 && s[0] < 0xF8 && (size_t)(end - p) >= n;
+    for (size_t i = 1; ok && i < n; i++)
+    {
+        ok = (s[i] & 0xC0) == 0x80;
+        c = (c << 6) | (s[i] & 0x3f);
+    }
+    if (!ok || c > 0x10FFFF)
+    {
+        append_u16(out, 0xfffd);
+        return 1;
+    }
+    if (c >= 0x10000)
+    {
+        c -= 0x10000;
+        append_u16(out, 0xd800 | (c >> 10));
+        c = 0xdc00 | (c & 0x3ff);
+    }
+    append_u16(out, c);
+    return n;
+}
+
+// 原样输出, 非 ASCII 字符转义为 \uXXXX
+static void append_ascii(struct buffer *out, const char *p, size_t len)
+{
+    const char *lit = p;
+    const char *end = p + len;
+    while (p < end)
+    {
+        if ((unsigned char)*p < 0x80)
+        {
+            p++;
+            continue;
+        }
+        buf_append(out, lit, p - lit);
+        p += append_utf8_escaped(out, p, end);
+        lit = p;
+    }
+    buf_append(out, lit, end - lit);
+}
+
+// 按 JSON 字符串内容转义, 非 ASCII 字符同样转义, 与静态参数经 utf82ascii 编码的结果一致
+static void append_escaped(struct buffer *out, const char *p, size_t len, bool csv_quoted)
+{
+    const char *lit = p;
+    const char *end = p + len;
+    for (; p < end; p++)
+    {
+        unsigned char c = *p;
+        if (c != '"' && c != '\\' && c >= 0x20 && c < 0x80)
+        {
+            continue;
+        }
+        buf_append(out, lit, p - lit);
+        lit = p + 1;
+        if (c >= 0x80)
+        {
+            p += append_utf8_escaped(out, p, end) - 1;
+            lit = p + 1;
+        }
+        else if (c == '"')
+        {
+            // CSV 中 "" 为一个引号
+            if (csv_quoted && p + 1 < end && p[1] == '"')
+            {
+                p++;
+                lit++;
+            }
+            buf_append(out, "\\\"", 2);
+        }
+        else if (c == '\\')
+        {
+            buf_append(out, "\\\\", 2);
+        }
+        else
+        {
+            append_u16(out, c);
+        }
+    }
+    buf_append(out, lit, end - lit);
+}
+
+static void render_field(struct buffer *out, const struct dataset_field *f, bool in_str)
+{
+    switch (f->type)
+    {
+    case DATASET_FIELD_RAW:
+        if (in_str)
+        {
+            append_escaped(out, f->p, f->len, false);
+        }
+        else if (f->len)
+        {
+            append_ascii(out, f->p, f->len);
+        }
+        else
+        {
+            buf_append(out, "null", 4);
+        }
+        break;
+    case DATASET_FIELD_CSV_QUOTED:
+        if (!in_str)
+        {
+            buf_append(out, "\"", 1);
+        }
+        append_escaped(out, f->p, f->len, true);
+        if (!in_str)
+        {
+            buf_append(out, "\"", 1);
+        }
+        break;
+    case DATASET_FIELD_JSON_STR:
+        if (!in_str)
+        {
+            buf_append(out, "\"", 1);
+        }
+        append_ascii(out, f->p, f->len);
+        if (!in_str)
+        {
+            buf_append(out, "\"", 1);
+        }
+        break;
+    }
+}
+
+static void render_int(struct buffer *out, int64_t v)
+{
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%" PRId64, v);
+    buf_append(out, num, n);
+}
+
+void argtpl_render(const struct argtpl *tpl, struct argtpl_ctx *ctx, const char *line, size_t len, struct buffer *out)
+{
+    for (int i = 0; i < tpl->seg_n; i++)
+    {
+        const struct seg *s = &tpl->segs[i];
+        switch (s->type)
+        {
+        case SEG_LITERAL:
+            buf_append(out, s->p, s->len);
+            break;
+        case SEG_FIELD:
+        {
+            struct dataset_field f;
+            if (dataset_field(tpl->ds, line, len, s->col, s->name, &f))
+            {
+                render_field(out, &f, s->in_str);
+            }
+            else if (!s->in_str)
+            {
+                buf_append(out, "null", 4);
+            }
+        }
+        break;
+        case SEG_ZIPF:
+            render_int(out, zipf_next(&s->zipf, &ctx->rng));
+            break;
+        case SEG_UNIFORM:
+            render_int(out, s->lo + (int64_t)rng_below64(&ctx->rng, (uint64_t)(s->hi - s->lo) + 1));
+            break;
+        case SEG_HOTSPOT:
+            if (rng_double(&ctx->rng) < s->hot_p)
+            {
+                render_int(out, s->lo + (int64_t)rng_below64(&ctx->rng, s->hot_n));
+            }
+            else
+            {
+                render_int(out, s->lo + s->hot_n + (int64_t)rng_below64(&ctx->rng, s->hi - s->hot_n));
+            }
+            break;
+        case SEG_SEQ:
+            render_int(out, s->lo + ctx->seq);
+            ctx->seq += ctx->seq_step;
+            break;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef ARGTPL_H
+#define ARGTPL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "dataset.h"
+#include "rng.h"
+
+// 请求参数模板: JSON 参数文本中的 {{$N}} (从 1 开始的列号) 或 {{$name}} (CSV 列名 / JSONL 键名)
+// 在发送时替换为数据集当前行的字段, 其余文本原样输出
+// 占位符位于 JSON 字符串内时字段按字符串内容转义; 位于字符串外时原样输出, 带引号的字段输出为 JSON 字符串, 缺失字段输出 null
+//
+// 以及按分布生成的整数 key:
+//   {{zipf:N:theta}}      [1, N] 上的 zipf 分布, 1 最热, 0 < theta < 1
+//   {{uniform:a:b}}       [a, b] 上的均匀分布
+//   {{hotspot:h:p[:N]}}   [1, N] 中前 h 比例的 key 占 p 比例的请求, N 默认 1000000
+//   {{seq[:start]}}       递增序号, 各线程交错取值互不重复
+
+struct argtpl;
+
+// 渲染状态, 每个线程一份
+struct argtpl_ctx
+{
+    uint64_t rng;
+    int64_t seq;
+    int64_t seq_step;
+};
+
+static inline void argtpl_ctx_init(struct argtpl_ctx *ctx, uint64_t seed, int id, int parts)
+{
+    ctx->rng = rng_seed(seed, id);
+    ctx->seq = id;
+    ctx->seq_step = parts;
+}
+
+// 未引用数据集时 ds 可为 NULL; 失败返回 NULL 并输出原因
+struct argtpl *argtpl_compile(const char *text, const struct dataset *ds);
+void argtpl_release(struct argtpl *);
+
+// 不含占位符, 参数固定
+bool argtpl_is_static(const struct argtpl *);
+// 引用了数据集字段, 每次渲染消耗一行
+bool argtpl_uses_data(const struct argtpl *);
+
+// 以数据集一行渲染参数, 追加到 out; 未引用数据集时 line 可为 NULL
+void argtpl_render(const struct argtpl *, struct argtpl_ctx *, const char *line, size_t len, struct buffer *out);
+
+#endif
@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "balance.h"
+#include "rng.h"
+
+/* EWMA 平滑系数, 约等于最近 10 个样本的滑动平均 */
+#define LB_EWMA_ALPHA 0.1
+/* EWMA 按距上次更新的时间指数衰减的时间常数 */
+#define LB_EWMA_DECAY_US 100000.0
+
+static const char *balance_names[] = {"rr", "random", "least", "p2c"};
+
+void lb_init(struct lb *lb, enum balance strategy, int node_n, uint64_t seed)
+{
+    memset(lb, 0, sizeof(*lb));
+    lb->strategy = strategy;
+    lb->node_n = node_n;
+    lb->nodes = calloc(node_n, sizeof(*lb->nodes));
+    assert(lb->nodes);
+    lb->scratch = calloc(node_n, sizeof(*lb->scratch));
+    assert(lb->scratch);
+    for (int i = 0; i < node_n; i++)
+    {
+        lb->nodes[i].weight = 1;
+    }
+    lb->rng = seed ? seed : 1;
+}
+
+void lb_destroy(struct lb *lb)
+{
+    free(lb->nodes);
+    free(lb->scratch);
+}
+
+static int lb_pick_rr(struct lb *lb)
+{
+    for (int i = 0; i < lb->node_n; i++)
+    {
+        int idx = lb->rr_idx;
+        lb->rr_idx = (lb->rr_idx + 1) % lb->node_n;
+        if (lb->nodes[idx].avail)
+        {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+static int lb_pick_random(struct lb *lb)
+{
+    int64_t total = 0;
+    for (int i = 0; i < lb->node_n; i++)
+    {
+        if (lb->nodes[i].avail)
+        {
+            total += lb->nodes[i].weight;
+        }
+    }
+    if (total == 0)
+    {
+        return -1;
+    }
+    int64_t r = (int64_t)(rng_double(&lb->rng) * total);
+    for (int i = 0; i < lb->node_n; i++)
+    {
+        if (!lb->nodes[i].avail)
+        {
+            continue;
+        }
+        r -= lb->nodes[i].weight;
+        if (r < 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int lb_pick_least(struct lb *lb)
+{
+    // 从轮询位置开始比较, 负载相同时依次轮换
+    int best = -1;
+    double best_load = 0;
+    for (int i = 0; i < lb->node_n; i++)
+    {
+        int idx = (lb->rr_idx + i) % lb->node_n;
+        struct lb_node *node = &lb->nodes[idx];
+        if (!node->avail)
+        {
+            continue;
+        }
+        double load = (double)node->inflight / node->weight;
+        if (best == -1 || load < best_load)
+        {
+            best = idx;
+            best_load = load;
+        }
+    }
+    lb->rr_idx = (lb->rr_idx + 1) % lb->node_n;
+    return best;
+}
+
+// 没有新样本的节点 EWMA 逐渐衰减, 偶发的慢响应不会让节点永远比较失败而再也得不到请求
+static double lb_ewma_at(const struct lb_node *node, uint64_t now_us)
+{
+    if (node->ewma_us == 0)
+    {
+        return 0;
+    }
+    double idle_us = now_us > node->stamp_us ? (double)(now_us - node->stamp_us) : 0;
+    return node->ewma_us * exp(-idle_us / LB_EWMA_DECAY_US);
+}
+
+static double lb_p2c_cost(const struct lb_node *node, double ewma_us)
+{
+    return ewma_us * (node->inflight + 1) / node->weight;
+}
+
+// 尚无样本的节点按其他节点的平均值估计, 不因为 0 抢走所有请求
+static double lb_p2c_ewma(const struct lb *lb, const struct lb_node *node, uint64_t now_us)
+{
+    if (node->ewma_us != 0)
+    {
+        return lb_ewma_at(node, now_us);
+    }
+    double sum = 0;
+    int n = 0;
+    for (int i = 0; i < lb->node_n; i++)
+    {
+        if (lb->nodes[i].ewma_us != 0)
+        {
+            sum += lb_ewma_at(&lb->nodes[i], now_us);
+            n++;
+        }
+    }
+    return n ? sum / n : 0;
+}
+
+static int lb_pick_p2c(struct lb *lb, uint64_t now_us)
+{
+    int n = 0;
+    for (int i = 0; i < lb->node_n; i++)
+    {
+        if (lb->nodes[i].avail)
+        {
+            lb->scratch[n++] = i;
+        }
+    }
+    if (n == 0)
+    {
+        return -1;
+    }
+    if (n == 1)
+    {
+        return lb->scratch[0];
+    }
+    uint32_t a = rng_below(&lb->rng, n);
+    uint32_t b = rng_below(&lb->rng, n - 1);
+    if (b >= a)
+    {
+        b++;
+    }
+    int ia = lb->scratch[a];
+    int ib = lb->scratch[b];
+    const struct lb_node *na = &lb->nodes[ia];
+    const struct lb_node *nb = &lb->nodes[ib];
+    return lb_p2c_cost(na, lb_p2c_ewma(lb, na, now_us)) <= lb_p2c_cost(nb, lb_p2c_ewma(lb, nb, now_us)) ? ia : ib;
+}
+
+int lb_pick(struct lb *lb, uint64_t now_us)
+{
+    switch (lb->strategy)
+    {
+    case BALANCE_RANDOM:
+        return lb_pick_random(lb);
+    case BALANCE_LEAST:
+        return lb_pick_least(lb);
+    case BALANCE_P2C:
+        return lb_pick_p2c(lb, now_us);
+    case BALANCE_RR:
+    default:
+        return lb_pick_rr(lb);
+    }
+}
+
+void lb_observe(struct lb *lb, int idx, uint64_t lat_us, uint64_t now_us)
+{
+    struct lb_node *node = &lb->nodes[idx];
+    if (node->ewma_us == 0)
+    {
+        node->ewma_us = lat_us;
+    }
+    else
+    {
+        double ewma_us = lb_ewma_at(node, now_us);
+        node->ewma_us = ewma_us + LB_EWMA_ALPHA * ((double)lat_us - ewma_us);
+    }
+    if (node->ewma_us <= 0)
+    {
+        // 0 表示尚无样本
+        node->ewma_us = 1;
+    }
+    node->stamp_us = now_us;
+}
+
+bool balance_parse(const char *name, enum balance *strategy)
+{
+    for (size_t i = 0; i < sizeof(balance_names) / sizeof(balance_names[0]); i++)
+    {
+        if (strcmp(name, balance_names[i]) == 0)
+        {
+            *strategy = (enum balance)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *balance_name(enum balance strategy)
+{
+    return balance_names[strategy];
+}
@@ -0,0 +1,49 @@
+#ifndef BALANCE_H
+#define BALANCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 多个 provider 之间的负载均衡, 只依赖各节点的权重/在途数/延迟, 与连接无关
+
+enum balance
+{
+    BALANCE_RR,     /* 轮询 */
+    BALANCE_RANDOM, /* 按权重随机 */
+    BALANCE_LEAST,  /* 在途请求数 / 权重最小 */
+    BALANCE_P2C,    /* 随机取两个, 选 EWMA 延迟 * (在途数 + 1) 较小者, EWMA 随空闲时间衰减 */
+};
+
+struct lb_node
+{
+    int weight;
+    int inflight;
+    double ewma_us;    /* 0 为尚无样本 */
+    uint64_t stamp_us; /* ewma_us 最近更新的时间 */
+    bool avail;     /* 有可用连接与空闲 pipeline */
+};
+
+struct lb
+{
+    enum balance strategy;
+    struct lb_node *nodes;
+    int node_n;
+    int rr_idx;
+    uint64_t rng;
+    int *scratch; /* p2c 候选 */
+};
+
+void lb_init(struct lb *, enum balance strategy, int node_n, uint64_t seed);
+void lb_destroy(struct lb *);
+
+// 返回选中的节点下标, 没有可用节点返回 -1
+int lb_pick(struct lb *, uint64_t now_us);
+
+// 记录一次响应延迟
+void lb_observe(struct lb *, int idx, uint64_t lat_us, uint64_t now_us);
+
+// "rr" / "random" / "least" / "p2c", 非法返回 false
+bool balance_parse(const char *name, enum balance *strategy);
+const char *balance_name(enum balance strategy);
+
+#endif
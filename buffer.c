@@ -575,7 +575,7 @@ ssize_t buf_readFd(struct buffer *buf, int fd, int *errno_)
     ssize_t n = readv(fd, vec, iovcnt);
     if (n < 0)
     {
-        *errno_ = n;
+        *errno_ = errno;
     }
     else if (n <= writable)
     {
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "capture.h"
+#include "log.h"
+
+#define CAPTURE_MAGIC "DBCAPTUR"
+#define CAPTURE_VERSION 1
+#define CAPTURE_BUF_SZ (4 * 1024 * 1024)
+
+struct capture
+{
+    int fd;
+    pthread_mutex_t lock;
+    bool failed;
+    uint64_t frame_n;
+    uint64_t bytes;
+};
+
+struct capture_buf
+{
+    struct capture *cap;
+    char *data;
+    size_t len;
+    uint64_t frame_n;
+};
+
+struct capture_reader
+{
+    const char *path;
+    const char *data;
+    size_t size;
+    size_t pos;
+};
+
+static bool write_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+struct capture *capture_open(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        LOG_ERROR("打开 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct capture_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CAPTURE_MAGIC, sizeof(hdr.magic));
+    hdr.version = CAPTURE_VERSION;
+    struct timeval tv;
+    struct timespec ts;
+    gettimeofday(&tv, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    hdr.wall_us = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    hdr.mono_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (!write_all(fd, (const char *)&hdr, sizeof(hdr)))
+    {
+        LOG_ERROR("写入 %s 失败: %s", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    struct capture *cap = calloc(1, sizeof(*cap));
+    assert(cap);
+    cap->fd = fd;
+    cap->bytes = sizeof(hdr);
+    pthread_mutex_init(&cap->lock, NULL);
+    return cap;
+}
+
+bool capture_close(struct capture *cap)
+{
+    bool ok = !cap->failed;
+    if (close(cap->fd) != 0)
+    {
+        ok = false;
+    }
+    pthread_mutex_destroy(&cap->lock);
+    free(cap);
+    return ok;
+}
+
+uint64_t capture_frame_n(const struct capture *cap)
+{
+    return cap->frame_n;
+}
+
+uint64_t capture_bytes(const struct capture *cap)
+{
+    return cap->bytes;
+}
+
+// O_APPEND 下整块一次写入, 各线程的块不会交叉
+static void capture_write(struct capture_buf *b, const char *data, size_t len)
+{
+    struct capture *cap = b->cap;
+    pthread_mutex_lock(&cap->lock);
+    if (!cap->failed)
+    {
+        if (write_all(cap->fd, data, len))
+        {
+            cap->bytes += len;
+        }
+        else
+        {
+            LOG_ERROR("写入流量录制失败: %s", strerror(errno));
+            cap->failed = true;
+        }
+    }
+    pthread_mutex_unlock(&cap->lock);
+}
+
+static void capture_flush(struct capture_buf *b)
+{
+    if (b->len == 0)
+    {
+        return;
+    }
+    capture_write(b, b->data, b->len);
+    b->len = 0;
+}
+
+struct capture_buf *capture_buf_create(struct capture *cap)
+{
+    struct capture_buf *b = calloc(1, sizeof(*b));
+    assert(b);
+    b->cap = cap;
+    b->data = malloc(CAPTURE_BUF_SZ);
+    assert(b->data);
+    return b;
+}
+
+void capture_buf_release(struct capture_buf *b)
+{
+    capture_flush(b);
+    pthread_mutex_lock(&b->cap->lock);
+    b->cap->frame_n += b->frame_n;
+    pthread_mutex_unlock(&b->cap->lock);
+    free(b->data);
+    free(b);
+}
+
+void capture_add(struct capture_buf *b, uint64_t ts_us, uint32_t conn, int dir, int64_t reqid, const char *frame, uint32_t len)
+{
+    struct capture_entry e;
+    e.ts_us = ts_us;
+    e.reqid = reqid;
+    e.conn = conn;
+    e.dir = dir;
+    e.len = len;
+    e.reserved = 0;
+
+    size_t need = sizeof(e) + len;
+    if (b->len + need > CAPTURE_BUF_SZ)
+    {
+        capture_flush(b);
+    }
+    b->frame_n++;
+    if (need > CAPTURE_BUF_SZ)
+    {
+        // 超大帧直接写出, 记录头与帧须在同一块内
+        char *big = malloc(need);
+        assert(big);
+        memcpy(big, &e, sizeof(e));
+        memcpy(big + sizeof(e), frame, len);
+        capture_write(b, big, need);
+        free(big);
+        return;
+    }
+    memcpy(b->data + b->len, &e, sizeof(e));
+    memcpy(b->data + b->len + sizeof(e), frame, len);
+    b->len += need;
+}
+
+struct capture_reader *capture_reader_open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("打开录制文件 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct capture_hdr))
+    {
+        LOG_ERROR("%s 不是合法的录制文件 (--record 生成)", path);
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        LOG_ERROR("映射录制文件 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    const struct capture_hdr *hdr = (const struct capture_hdr *)data;
+    if (memcmp(hdr->magic, CAPTURE_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != CAPTURE_VERSION)
+    {
+        LOG_ERROR("%s 不是合法的录制文件 (--record 生成)", path);
+        munmap(data, st.st_size);
+        return NULL;
+    }
+
+    struct capture_reader *r = calloc(1, sizeof(*r));
+    assert(r);
+    r->path = path;
+    r->data = data;
+    r->size = st.st_size;
+    r->pos = sizeof(*hdr);
+    return r;
+}
+
+void capture_reader_close(struct capture_reader *r)
+{
+    munmap((void *)r->data, r->size);
+    free(r);
+}
+
+const struct capture_hdr *capture_reader_hdr(const struct capture_reader *r)
+{
+    return (const struct capture_hdr *)r->data;
+}
+
+bool capture_reader_next(struct capture_reader *r, struct capture_entry *entry, const char **frame)
+{
+    size_t left = r->size - r->pos;
+    if (left == 0)
+    {
+        return false;
+    }
+    // 帧长不定, 记录头未必对齐, 复制后读取
+    if (left >= sizeof(*entry))
+    {
+        memcpy(entry, r->data + r->pos, sizeof(*entry));
+        if (entry->len <= left - sizeof(*entry))
+        {
+            *frame = r->data + r->pos + sizeof(*entry);
+            r->pos += sizeof(*entry) + entry->len;
+            return true;
+        }
+    }
+    LOG_ERROR("录制文件 %s 末尾 %zu 字节不完整, 已忽略", r->path, left);
+    r->pos = r->size;
+    return false;
+}
@@ -0,0 +1,63 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 流量录制: 逐帧记录压测中发送与接收的原始 Dubbo 帧, 用于复现线上问题与回放
+// 每个工作线程写自己的大块缓冲, 满了才加锁追加到文件, 录制几乎不增加发送开销
+// 文件格式 (本机字节序, 只在同类机器间使用):
+//   header: magic "DBCAPTUR", version u32, reserved u32, wall_us u64, mono_us u64 (同一时刻的 unix 时间与单调时钟)
+//   entries: {ts_us u64, reqid i64, conn u32, dir u32, len u32, reserved u32} 后接 len 字节的完整帧
+// 各线程的记录按缓冲块交错, 块内按时间有序, 块间需按 ts_us 排序
+// 读取时整个文件只读映射, 按记录顺序遍历
+
+#define CAPTURE_SEND 0
+#define CAPTURE_RECV 1
+
+struct capture_hdr
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t wall_us;
+    uint64_t mono_us;
+};
+
+struct capture_entry
+{
+    uint64_t ts_us; /* CLOCK_MONOTONIC */
+    int64_t reqid;
+    uint32_t conn; /* 全局连接编号 */
+    uint32_t dir;  /* CAPTURE_SEND / CAPTURE_RECV */
+    uint32_t len;
+    uint32_t reserved;
+};
+
+struct capture;
+struct capture_buf;
+struct capture_reader;
+
+// 失败返回 NULL 并输出原因
+struct capture *capture_open(const char *path);
+// 所有线程缓冲释放后调用, 返回写入是否全部成功
+bool capture_close(struct capture *);
+uint64_t capture_frame_n(const struct capture *);
+uint64_t capture_bytes(const struct capture *);
+
+// 每个线程一个, 释放时写出剩余数据
+struct capture_buf *capture_buf_create(struct capture *);
+void capture_buf_release(struct capture_buf *);
+
+void capture_add(struct capture_buf *, uint64_t ts_us, uint32_t conn, int dir, int64_t reqid, const char *frame, uint32_t len);
+
+// 失败返回 NULL 并输出原因
+struct capture_reader *capture_reader_open(const char *path);
+void capture_reader_close(struct capture_reader *);
+const struct capture_hdr *capture_reader_hdr(const struct capture_reader *);
+
+// 按文件顺序读取下一条记录, frame 指向映射的只读内存; 读完返回 false
+// 录制被强制中断时末尾记录可能不完整, 忽略并输出警告
+bool capture_reader_next(struct capture_reader *, struct capture_entry *entry, const char **frame);
+
+#endif
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "corpus.h"
+#include "dubbo_codec.h"
+#include "log.h"
+
+#define CORPUS_MAGIC "DBCORPUS"
+#define CORPUS_VERSION 1
+#define CORPUS_WRITE_BUF_SZ (4 * 1024 * 1024)
+
+struct corpus_hdr
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t method_n;
+    uint64_t frame_n;
+    uint64_t index_off;
+};
+
+struct corpus_index
+{
+    uint64_t offset;
+    uint32_t len;
+    uint32_t method;
+};
+
+struct corpus_writer
+{
+    FILE *fp;
+    char *path;
+    char *wbuf;
+    uint64_t off;
+
+    char **method_names;
+    int method_n;
+
+    struct corpus_index *index;
+    uint64_t frame_n;
+    uint64_t index_cap;
+};
+
+struct corpus
+{
+    const char *data; /* mmap */
+    size_t size;
+    const struct corpus_hdr *hdr;
+    const struct corpus_index *index;
+    char **method_names;
+};
+
+struct corpus_writer *corpus_writer_create(const char *path, const char **method_names, int method_n)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        LOG_ERROR("打开 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct corpus_writer *w = calloc(1, sizeof(*w));
+    assert(w);
+    w->fp = fp;
+    w->path = strdup(path);
+    // 大块缓冲, 避免每帧一次 write
+    w->wbuf = malloc(CORPUS_WRITE_BUF_SZ);
+    assert(w->wbuf);
+    setvbuf(fp, w->wbuf, _IOFBF, CORPUS_WRITE_BUF_SZ);
+
+    w->method_n = method_n;
+    w->method_names = calloc(method_n, sizeof(*w->method_names));
+    assert(w->method_names);
+    for (int i = 0; i < method_n; i++)
+    {
+        w->method_names[i] = strdup(method_names[i]);
+    }
+
+    // header 最后回填
+    struct corpus_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    w->off = sizeof(hdr);
+    return w;
+}
+
+bool corpus_writer_add(struct corpus_writer *w, int method, const struct buffer *frame)
+{
+    size_t len = buf_readable(frame);
+    if (fwrite(buf_peek(frame), 1, len, w->fp) != len)
+    {
+        return false;
+    }
+    if (w->frame_n == w->index_cap)
+    {
+        w->index_cap = w->index_cap ? w->index_cap * 2 : 1024;
+        w->index = realloc(w->index, w->index_cap * sizeof(*w->index));
+        assert(w->index);
+    }
+    struct corpus_index *e = &w->index[w->frame_n++];
+    e->offset = w->off;
+    e->len = (uint32_t)len;
+    e->method = (uint32_t)method;
+    w->off += len;
+    return true;
+}
+
+uint64_t corpus_writer_frame_n(const struct corpus_writer *w)
+{
+    return w->frame_n;
+}
+
+static bool corpus_writer_finish(struct corpus_writer *w)
+{
+    static const char pad[8];
+    size_t pad_n = (8 - w->off % 8) % 8;
+    if (fwrite(pad, 1, pad_n, w->fp) != pad_n)
+    {
+        return false;
+    }
+
+    struct corpus_hdr hdr;
+    memcpy(hdr.magic, CORPUS_MAGIC, sizeof(hdr.magic));
+    hdr.version = CORPUS_VERSION;
+    hdr.method_n = w->method_n;
+    hdr.frame_n = w->frame_n;
+    hdr.index_off = w->off + pad_n;
+
+    if (fwrite(w->index, sizeof(*w->index), w->frame_n, w->fp) != w->frame_n)
+    {
+        return false;
+    }
+    for (int i = 0; i < w->method_n; i++)
+    {
+        uint16_t len = (uint16_t)strlen(w->method_names[i]);
+        if (fwrite(&len, sizeof(len), 1, w->fp) != 1 || fwrite(w->method_names[i], 1, len, w->fp) != len)
+        {
+            return false;
+        }
+    }
+    return fseek(w->fp, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, w->fp) == 1 && fflush(w->fp) == 0;
+}
+
+bool corpus_writer_close(struct corpus_writer *w)
+{
+    bool ok = corpus_writer_finish(w);
+    ok = fclose(w->fp) == 0 && ok;
+    if (!ok)
+    {
+        LOG_ERROR("写入 %s 失败: %s", w->path, strerror(errno));
+    }
+    for (int i = 0; i < w->method_n; i++)
+    {
+        free(w->method_names[i]);
+    }
+    free(w->method_names);
+    free(w->index);
+    free(w->wbuf);
+    free(w->path);
+    free(w);
+    return ok;
+}
+
+static bool corpus_check(struct corpus *c)
+{
+    if (c->size < sizeof(struct corpus_hdr))
+    {
+        return false;
+    }
+    c->hdr = (const struct corpus_hdr *)c->data;
+    if (memcmp(c->hdr->magic, CORPUS_MAGIC, sizeof(c->hdr->magic)) != 0 || c->hdr->version != CORPUS_VERSION)
+    {
+        return false;
+    }
+    if (c->hdr->frame_n == 0 || c->hdr->method_n == 0 || c->hdr->index_off % 8 != 0 ||
+        c->hdr->index_off > c->size || (c->size - c->hdr->index_off) / sizeof(struct corpus_index) < c->hdr->frame_n)
+    {
+        return false;
+    }
+    c->index = (const struct corpus_index *)(c->data + c->hdr->index_off);
+
+    const char *p = (const char *)(c->index + c->hdr->frame_n);
+    const char *end = c->data + c->size;
+    c->method_names = calloc(c->hdr->method_n, sizeof(*c->method_names));
+    assert(c->method_names);
+    for (uint32_t i = 0; i < c->hdr->method_n; i++)
+    {
+        uint16_t len;
+        if (end - p < (ptrdiff_t)sizeof(len))
+        {
+            return false;
+        }
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if (end - p < len)
+        {
+            return false;
+        }
+        c->method_names[i] = strndup(p, len);
+        p += len;
+    }
+
+    // 发送时按 len 改写帧头中的 reqid, 帧须是完整的请求帧, 否则会写到帧之前
+    for (uint64_t i = 0; i < c->hdr->frame_n; i++)
+    {
+        const struct corpus_index *e = &c->index[i];
+        if (e->offset < sizeof(struct corpus_hdr) || e->offset > c->hdr->index_off || e->len > c->hdr->index_off - e->offset ||
+            e->method >= c->hdr->method_n || !dubbo_frame_is_call(c->data + e->offset, e->len))
+        {
+            LOG_ERROR("语料第 %" PRIu64 " 帧非法: offset %" PRIu64 ", len %u", i, e->offset, e->len);
+            return false;
+        }
+    }
+    return true;
+}
+
+struct corpus *corpus_open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("打开语料 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        LOG_ERROR("语料 %s 为空或无法读取", path);
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        LOG_ERROR("映射语料 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    struct corpus *c = calloc(1, sizeof(*c));
+    assert(c);
+    c->data = data;
+    c->size = st.st_size;
+    if (!corpus_check(c))
+    {
+        LOG_ERROR("%s 不是合法的语料文件 (--compile-corpus 生成)", path);
+        corpus_close(c);
+        return NULL;
+    }
+    return c;
+}
+
+void corpus_close(struct corpus *c)
+{
+    if (c->method_names)
+    {
+        for (uint32_t i = 0; i < c->hdr->method_n; i++)
+        {
+            free(c->method_names[i]);
+        }
+        free(c->method_names);
+    }
+    munmap((void *)c->data, c->size);
+    free(c);
+}
+
+uint64_t corpus_frame_n(const struct corpus *c)
+{
+    return c->hdr->frame_n;
+}
+
+int corpus_method_n(const struct corpus *c)
+{
+    return (int)c->hdr->method_n;
+}
+
+const char *corpus_method_name(const struct corpus *c, int method)
+{
+    return c->method_names[method];
+}
+
+const char *corpus_frame(const struct corpus *c, uint64_t i, size_t *len, int *method)
+{
+    const struct corpus_index *e = &c->index[i];
+    *len = e->len;
+    *method = (int)e->method;
+    return c->data + e->offset;
+}
@@ -0,0 +1,38 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "buffer.h"
+
+// 预编码请求语料: 每个请求预先编码为完整的 Dubbo 请求帧, 压测时 mmap 后直接复制发送, 只改写 reqid
+// 文件格式 (本机字节序, 只在同类机器间使用):
+//   header: magic "DBCORPUS", version u32, method_n u32, frame_n u64, index_off u64
+//   frames: 依次排列的请求帧
+//   index:  frame_n 项 {offset u64, len u32, method u32}, 8 字节对齐
+//   methods: method_n 项 {len u16, "service.method"}
+
+struct corpus_writer;
+struct corpus;
+
+// 失败返回 NULL 并输出原因
+struct corpus_writer *corpus_writer_create(const char *path, const char **method_names, int method_n);
+bool corpus_writer_add(struct corpus_writer *, int method, const struct buffer *frame);
+// 写入索引并关闭, 返回是否成功
+bool corpus_writer_close(struct corpus_writer *);
+uint64_t corpus_writer_frame_n(const struct corpus_writer *);
+
+// 失败返回 NULL 并输出原因
+struct corpus *corpus_open(const char *path);
+void corpus_close(struct corpus *);
+
+uint64_t corpus_frame_n(const struct corpus *);
+int corpus_method_n(const struct corpus *);
+const char *corpus_method_name(const struct corpus *, int method);
+
+// 第 i 个请求帧, 指向映射的只读内存
+const char *corpus_frame(const struct corpus *, uint64_t i, size_t *len, int *method);
+
+#endif
@@ -0,0 +1,517 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dataset.h"
+#include "rng.h"
+#include "log.h"
+
+#define DATASET_BLOCK_SZ (64 * 1024)
+
+struct dataset
+{
+    enum dataset_fmt fmt;
+    bool shuffle;
+    bool wrap;
+
+    const char *data; /* mmap */
+    size_t size;
+    size_t begin; /* 跳过 CSV 列名行后的数据起点 */
+
+    char **columns;
+    int column_n;
+};
+
+struct dataset_cursor
+{
+    const struct dataset *ds;
+    size_t begin; /* [begin, end) 内开始的行属于本游标 */
+    size_t end;
+    size_t pos;
+    bool done;
+
+    // 打乱: 依次读取 blocks[block_idx] 块内开始的行
+    uint32_t *blocks;
+    uint32_t block_n;
+    uint32_t block_idx;
+    size_t block_end;
+    uint64_t rng;
+};
+
+static const char *has_suffix(const char *s, const char *suffix)
+{
+    size_t n = strlen(s);
+    size_t m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0 ? s + n - m : NULL;
+}
+
+// 下一行行首, 不超过 size
+static size_t next_line(const struct dataset *ds, size_t pos)
+{
+    const char *nl = memchr(ds->data + pos, '\n', ds->size - pos);
+    return nl ? (size_t)(nl - ds->data) + 1 : ds->size;
+}
+
+// pos 处或其后的第一个行首
+static size_t line_start_at(const struct dataset *ds, size_t pos)
+{
+    if (pos <= ds->begin)
+    {
+        return ds->begin;
+    }
+    if (pos >= ds->size)
+    {
+        return ds->size;
+    }
+    return ds->data[pos - 1] == '\n' ? pos : next_line(ds, pos);
+}
+
+static bool dataset_parse_header(struct dataset *ds)
+{
+    size_t end = next_line(ds, 0);
+    size_t len = end;
+    while (len > 0 && (ds->data[len - 1] == '\n' || ds->data[len - 1] == '\r'))
+    {
+        len--;
+    }
+    if (len == 0)
+    {
+        return false;
+    }
+    ds->begin = end;
+
+    ds->column_n = 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (ds->data[i] == ',')
+        {
+            ds->column_n++;
+        }
+    }
+    ds->columns = calloc(ds->column_n, sizeof(*ds->columns));
+    assert(ds->columns);
+    for (int i = 0; i < ds->column_n; i++)
+    {
+        struct dataset_field f;
+        if (!dataset_field(ds, ds->data, len, i, NULL, &f))
+        {
+            return false;
+        }
+        ds->columns[i] = strndup(f.p, f.len);
+    }
+    return true;
+}
+
+struct dataset *dataset_open(const char *path, bool shuffle, bool wrap)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("打开数据集 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        LOG_ERROR("数据集 %s 为空或无法读取", path);
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        LOG_ERROR("映射数据集 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+    madvise(data, st.st_size, shuffle ? MADV_RANDOM : MADV_SEQUENTIAL);
+
+    struct dataset *ds = calloc(1, sizeof(*ds));
+    assert(ds);
+    ds->data = data;
+    ds->size = st.st_size;
+    ds->shuffle = shuffle;
+    ds->wrap = wrap;
+    ds->fmt = has_suffix(path, ".jsonl") || has_suffix(path, ".json") ? DATASET_JSONL : DATASET_CSV;
+
+    if (ds->fmt == DATASET_CSV && !dataset_parse_header(ds))
+    {
+        LOG_ERROR("数据集 %s 缺少 CSV 列名行", path);
+        dataset_close(ds);
+        return NULL;
+    }
+    if (ds->begin >= ds->size)
+    {
+        LOG_ERROR("数据集 %s 没有数据行", path);
+        dataset_close(ds);
+        return NULL;
+    }
+    return ds;
+}
+
+void dataset_close(struct dataset *ds)
+{
+    for (int i = 0; i < ds->column_n; i++)
+    {
+        free(ds->columns[i]);
+    }
+    free(ds->columns);
+    munmap((void *)ds->data, ds->size);
+    free(ds);
+}
+
+enum dataset_fmt dataset_format(const struct dataset *ds)
+{
+    return ds->fmt;
+}
+
+int dataset_column(const struct dataset *ds, const char *name)
+{
+    for (int i = 0; i < ds->column_n; i++)
+    {
+        if (strcmp(ds->columns[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void cursor_shuffle(struct dataset_cursor *cur)
+{
+    for (uint32_t i = cur->block_n - 1; i > 0; i--)
+    {
+        uint32_t j = rng_below(&cur->rng, i + 1);
+        uint32_t tmp = cur->blocks[i];
+        cur->blocks[i] = cur->blocks[j];
+        cur->blocks[j] = tmp;
+    }
+    cur->block_idx = 0;
+    cur->block_end = cur->pos = cur->begin;
+}
+
+struct dataset_cursor *dataset_cursor_create(const struct dataset *ds, int part, int parts, uint64_t seed)
+{
+    struct dataset_cursor *cur = calloc(1, sizeof(*cur));
+    assert(cur);
+    cur->ds = ds;
+
+    size_t data_sz = ds->size - ds->begin;
+    cur->begin = line_start_at(ds, ds->begin + data_sz / parts * part);
+    cur->end = part == parts - 1 ? ds->size : line_start_at(ds, ds->begin + data_sz / parts * (part + 1));
+    if (cur->begin >= cur->end)
+    {
+        // 行数少于线程数, 共用全部数据
+        cur->begin = ds->begin;
+        cur->end = ds->size;
+    }
+    cur->pos = cur->begin;
+    cur->rng = seed ? seed : 1;
+
+    if (ds->shuffle)
+    {
+        cur->block_n = (cur->end - cur->begin + DATASET_BLOCK_SZ - 1) / DATASET_BLOCK_SZ;
+        cur->blocks = malloc(cur->block_n * sizeof(*cur->blocks));
+        assert(cur->blocks);
+        for (uint32_t i = 0; i < cur->block_n; i++)
+        {
+            cur->blocks[i] = i;
+        }
+        cursor_shuffle(cur);
+    }
+    return cur;
+}
+
+void dataset_cursor_release(struct dataset_cursor *cur)
+{
+    free(cur->blocks);
+    free(cur);
+}
+
+// 顺序读取时 [pos, end) 内下一行; 打乱时 [pos, block_end) 内下一行, 块读完换下一块
+static bool cursor_advance(struct dataset_cursor *cur, size_t *line_begin)
+{
+    const struct dataset *ds = cur->ds;
+    if (!ds->shuffle)
+    {
+        if (cur->pos >= cur->end)
+        {
+            return false;
+        }
+        *line_begin = cur->pos;
+        cur->pos = next_line(ds, cur->pos);
+        return true;
+    }
+
+    while (cur->pos >= cur->block_end)
+    {
+        if (cur->block_idx == cur->block_n)
+        {
+            return false;
+        }
+        size_t b = cur->begin + (size_t)cur->blocks[cur->block_idx++] * DATASET_BLOCK_SZ;
+        size_t e = b + DATASET_BLOCK_SZ;
+        cur->pos = line_start_at(ds, b);
+        cur->block_end = e < cur->end ? e : cur->end;
+    }
+    *line_begin = cur->pos;
+    cur->pos = next_line(ds, cur->pos);
+    return true;
+}
+
+bool dataset_next(struct dataset_cursor *cur, const char **line, size_t *len)
+{
+    const struct dataset *ds = cur->ds;
+    if (cur->done)
+    {
+        return false;
+    }
+
+    // 一轮中全是空行时不再循环
+    bool wrapped = false;
+    for (;;)
+    {
+        size_t b;
+        if (!cursor_advance(cur, &b))
+        {
+            if (!ds->wrap || wrapped)
+            {
+                cur->done = true;
+                return false;
+            }
+            wrapped = true;
+            if (ds->shuffle)
+            {
+                cursor_shuffle(cur);
+            }
+            else
+            {
+                cur->pos = cur->begin;
+            }
+            continue;
+        }
+
+        size_t e = cur->pos;
+        while (e > b && (ds->data[e - 1] == '\n' || ds->data[e - 1] == '\r'))
+        {
+            e--;
+        }
+        if (e == b)
+        {
+            continue;
+        }
+        *line = ds->data + b;
+        *len = e - b;
+        return true;
+    }
+}
+
+static bool csv_field(const char *p, const char *end, int col, struct dataset_field *field)
+{
+    for (int i = 0;; i++)
+    {
+        const char *f = p;
+        bool quoted = p < end && *p == '"';
+        if (quoted)
+        {
+            // "" 为转义的引号
+            p++;
+            f = p;
+            while (p < end && !(*p == '"' && (p + 1 == end || p[1] != '"')))
+            {
+                p += *p == '"' ? 2 : 1;
+            }
+            if (i == col)
+            {
+                field->p = f;
+                field->len = p - f;
+                field->type = DATASET_FIELD_CSV_QUOTED;
+                return true;
+            }
+            p = memchr(p, ',', end - p);
+        }
+        else
+        {
+            p = memchr(p, ',', end - p);
+            if (i == col)
+            {
+                field->p = f;
+                field->len = (p ? p : end) - f;
+                field->type = DATASET_FIELD_RAW;
+                return true;
+            }
+        }
+        if (p == NULL)
+        {
+            return false;
+        }
+        p++;
+    }
+}
+
+static const char *json_skip_ws(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    {
+        p++;
+    }
+    return p;
+}
+
+static const char *json_skip_str(const char *p, const char *end)
+{
+    // p 指向开始引号, 返回结束引号之后
+    for (p++; p < end; p++)
+    {
+        if (*p == '\\')
+        {
+            p++;
+        }
+        else if (*p == '"')
+        {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+static const char *json_skip_value(const char *p, const char *end)
+{
+    if (p >= end)
+    {
+        return NULL;
+    }
+    if (*p == '"')
+    {
+        return json_skip_str(p, end);
+    }
+    if (*p == '{' || *p == '[')
+    {
+        int depth = 0;
+        while (p < end)
+        {
+            if (*p == '"')
+            {
+                p = json_skip_str(p, end);
+                if (p == NULL)
+                {
+                    return NULL;
+                }
+                continue;
+            }
+            if (*p == '{' || *p == '[')
+            {
+                depth++;
+            }
+            else if (*p == '}' || *p == ']')
+            {
+                if (--depth == 0)
+                {
+                    return p + 1;
+                }
+            }
+            p++;
+        }
+        return NULL;
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r')
+    {
+        p++;
+    }
+    return p;
+}
+
+static void json_value_field(const char *v, const char *v_end, struct dataset_field *field)
+{
+    if (*v == '"')
+    {
+        field->p = v + 1;
+        field->len = v_end - v - 2;
+        field->type = DATASET_FIELD_JSON_STR;
+    }
+    else
+    {
+        field->p = v;
+        field->len = v_end - v;
+        field->type = DATASET_FIELD_RAW;
+    }
+}
+
+// 只扫描原始文本取出字段, 不构建 JSON 树, 大整数不丢精度
+static bool jsonl_field(const char *p, const char *end, int col, const char *name, struct dataset_field *field)
+{
+    p = json_skip_ws(p, end);
+    if (p >= end || (*p != '{' && *p != '['))
+    {
+        return false;
+    }
+    bool is_obj = *p == '{';
+    if (is_obj != (name != NULL))
+    {
+        return false;
+    }
+    size_t name_len = name ? strlen(name) : 0;
+
+    p++;
+    for (int i = 0;; i++)
+    {
+        p = json_skip_ws(p, end);
+        if (p >= end || *p == '}' || *p == ']')
+        {
+            return false;
+        }
+        bool match = i == col;
+        if (is_obj)
+        {
+            if (*p != '"')
+            {
+                return false;
+            }
+            const char *k = p + 1;
+            p = json_skip_str(p, end);
+            if (p == NULL)
+            {
+                return false;
+            }
+            match = (size_t)(p - 1 - k) == name_len && memcmp(k, name, name_len) == 0;
+            p = json_skip_ws(p, end);
+            if (p >= end || *p != ':')
+            {
+                return false;
+            }
+            p = json_skip_ws(p + 1, end);
+        }
+
+        const char *v = p;
+        p = json_skip_value(p, end);
+        if (p == NULL || p == v)
+        {
+            return false;
+        }
+        if (match)
+        {
+            json_value_field(v, p, field);
+            return true;
+        }
+        p = json_skip_ws(p, end);
+        if (p >= end || *p != ',')
+        {
+            return false;
+        }
+        p++;
+    }
+}
+
+bool dataset_field(const struct dataset *ds, const char *line, size_t len, int col, const char *name, struct dataset_field *field)
+{
+    if (ds->fmt == DATASET_CSV)
+    {
+        return csv_field(line, line + len, col, field);
+    }
+    return jsonl_field(line, line + len, col, name, field);
+}
@@ -0,0 +1,53 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 压测参数数据集: CSV (首行为列名) 或 JSONL (每行一个 JSON 对象或数组)
+// 文件 mmap 只读映射, 不载入堆内存; 每个线程一个游标, 读取文件中互不重叠的一段
+// 顺序读取时按行前进; 打乱时按 64KB 块随机排列, 块内顺序读取, 每轮每行恰好读取一次
+
+enum dataset_fmt
+{
+    DATASET_CSV,
+    DATASET_JSONL,
+};
+
+enum dataset_field_type
+{
+    DATASET_FIELD_RAW,        /* 原样输出, 如 CSV 未加引号的字段, JSON 数字/对象 */
+    DATASET_FIELD_CSV_QUOTED, /* CSV 引号内的内容, "" 为转义的引号 */
+    DATASET_FIELD_JSON_STR,   /* JSON 字符串引号内的内容, 已转义 */
+};
+
+struct dataset_field
+{
+    const char *p;
+    size_t len;
+    enum dataset_field_type type;
+};
+
+struct dataset;
+struct dataset_cursor;
+
+// .jsonl/.json 后缀为 JSONL, 其余为 CSV; 失败返回 NULL 并输出原因
+struct dataset *dataset_open(const char *path, bool shuffle, bool wrap);
+void dataset_close(struct dataset *);
+
+enum dataset_fmt dataset_format(const struct dataset *);
+// CSV 列名对应的下标, 不存在返回 -1
+int dataset_column(const struct dataset *, const char *name);
+
+// 第 part 个线程的游标, 共 parts 个
+struct dataset_cursor *dataset_cursor_create(const struct dataset *, int part, int parts, uint64_t seed);
+void dataset_cursor_release(struct dataset_cursor *);
+
+// 下一行, 不含换行符, 跳过空行; 不循环且已读完返回 false
+bool dataset_next(struct dataset_cursor *, const char **line, size_t *len);
+
+// 取字段: CSV 按列下标; JSONL 对象按 name, 数组按 col (name 为 NULL); 不存在返回 false
+bool dataset_field(const struct dataset *, const char *line, size_t len, int col, const char *name, struct dataset_field *field);
+
+#endif
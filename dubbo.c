@@ -7,15 +7,88 @@
 #include <sys/time.h>
 #include <ctype.h> /*isspace*/
 #include <inttypes.h>
+#include <getopt.h>
+#include <assert.h>
 
 #include "dubbo_client.h"
+#include "scenario.h"
+#include "corpus.h"
+#include "replay.h"
 #include "log.h"
 
 #include "lib/cJSON.h"
 #include "lib/ae/ae.h"
 
 extern char *optarg;
-static const char *optString = "h:p:m:a:e:t:c:n:v?";
+static const char *optString = "h:p:m:a:e:t:c:C:T:n:d:w:R:v?";
+
+// 只有长选项的参数
+enum
+{
+    OPT_HIST_OUT = 256,
+    OPT_REQ_TIMEOUT,
+    OPT_REPORT_INTERVAL,
+    OPT_REPORT_OUT,
+    OPT_REPORT_FORMAT,
+    OPT_JSON_OUT,
+    OPT_BALANCE,
+    OPT_SCENARIO,
+    OPT_DATASET,
+    OPT_DATASET_SHUFFLE,
+    OPT_DATASET_WRAP,
+    OPT_COMPILE_CORPUS,
+    OPT_CORPUS,
+    OPT_SEED,
+    OPT_SEARCH,
+    OPT_SLO,
+    OPT_PROFILE,
+    OPT_RECORD,
+    OPT_REPLAY,
+    OPT_REPLAY_SPEED,
+    OPT_QPS_SERIES,
+    OPT_HEARTBEAT,
+    OPT_PING,
+};
+
+static const struct option longOpts[] = {
+    {"host", required_argument, NULL, 'h'},
+    {"port", required_argument, NULL, 'p'},
+    {"method", required_argument, NULL, 'm'},
+    {"args", required_argument, NULL, 'a'},
+    {"attach", required_argument, NULL, 'e'},
+    {"timeout", required_argument, NULL, 't'},
+    {"concurrency", required_argument, NULL, 'c'},
+    {"connections", required_argument, NULL, 'C'},
+    {"threads", required_argument, NULL, 'T'},
+    {"requests", required_argument, NULL, 'n'},
+    {"duration", required_argument, NULL, 'd'},
+    {"warmup", required_argument, NULL, 'w'},
+    {"rate", required_argument, NULL, 'R'},
+    {"verbos", no_argument, NULL, 'v'},
+    {"hist-out", required_argument, NULL, OPT_HIST_OUT},
+    {"req-timeout", required_argument, NULL, OPT_REQ_TIMEOUT},
+    {"report-interval", required_argument, NULL, OPT_REPORT_INTERVAL},
+    {"report-out", required_argument, NULL, OPT_REPORT_OUT},
+    {"report-format", required_argument, NULL, OPT_REPORT_FORMAT},
+    {"json-out", required_argument, NULL, OPT_JSON_OUT},
+    {"balance", required_argument, NULL, OPT_BALANCE},
+    {"scenario", required_argument, NULL, OPT_SCENARIO},
+    {"dataset", required_argument, NULL, OPT_DATASET},
+    {"dataset-shuffle", no_argument, NULL, OPT_DATASET_SHUFFLE},
+    {"dataset-wrap", no_argument, NULL, OPT_DATASET_WRAP},
+    {"compile-corpus", required_argument, NULL, OPT_COMPILE_CORPUS},
+    {"corpus", required_argument, NULL, OPT_CORPUS},
+    {"seed", required_argument, NULL, OPT_SEED},
+    {"search", required_argument, NULL, OPT_SEARCH},
+    {"slo", required_argument, NULL, OPT_SLO},
+    {"profile", required_argument, NULL, OPT_PROFILE},
+    {"record", required_argument, NULL, OPT_RECORD},
+    {"replay", required_argument, NULL, OPT_REPLAY},
+    {"replay-speed", required_argument, NULL, OPT_REPLAY_SPEED},
+    {"qps-series", required_argument, NULL, OPT_QPS_SERIES},
+    {"heartbeat", required_argument, NULL, OPT_HEARTBEAT},
+    {"ping", optional_argument, NULL, OPT_PING},
+    {NULL, no_argument, NULL, 0}};
 
 #define ASSERT_OPT(assert, reason, ...)                                  \
     if (!(assert))                                                       \
@@ -24,13 +97,39 @@ static const char *optString = "h:p:m:a:e:t:c:n:v?";
         usage();                                                         \
     }
 
-// fixme support attach
 static void
 usage()
 {
     static const char *usage =
         "\nUsage:\n"
-        "   dubbo_test -h<HOST> -p<PORT> -m<METHOD> -a<JSON_ARGUMENTS> [-e<JSON_ATTACHMENT='{}'> -t<TIMEOUT_SEC=5> -c<CONCURRENCY> -n<REQUESTS> -v<VERBOS>]\n\n"
+        "   dubbo_test -h<HOST> -p<PORT> -m<METHOD> -a<JSON_ARGUMENTS> [-e<JSON_ATTACHMENT='{}'> -t<TIMEOUT_SEC=5> -c<CONCURRENCY> -C<CONNECTIONS=1> -T<THREADS=1> -n<REQUESTS> -d<DURATION> -w<WARMUP> -R<TARGET_QPS> -v<VERBOS>]\n\n"
+        "Bench Options:\n"
+        "   -h<HOST[:PORT][@WEIGHT],...>  多个 provider 以逗号分隔, 未指定端口使用 -p, 权重默认 1; -C 为每个 provider 的连接数\n"
+        "   --balance=<rr|random|least|p2c>  多个 provider 的负载均衡: 轮询/按权重随机/最少在途/两次随机选 EWMA 延迟较低者, 默认 rr\n"
+        "   --scenario=<FILE>    多方法混合压测, JSON 数组 [{\"method\":\"svc.method\",\"args\":[...],\"attach\":{},\"weight\":70}, ...], 代替 -m -a -e\n"
+        "   --dataset=<FILE>     参数数据集, CSV (首行为列名) 或 .jsonl (每行一个 JSON 对象/数组), 参数中 {{$N}} (从 1 开始的列号) 或 {{$name}} 逐个请求替换为当前行的字段\n"
+        "   --dataset-shuffle    按 64KB 块打乱数据集读取顺序, 每轮每行仍只读一次\n"
+        "   --dataset-wrap       数据集读完后从头循环, 否则读完即结束压测; 同样适用于 --corpus\n"
+        "   --seed=<N>           参数模板中 {{zipf:N:theta}} {{uniform:a:b}} {{hotspot:h:p[:N]}} {{seq}} 的随机种子, 默认 0\n"
+        "   --compile-corpus=<FILE>  不压测, 将数据集每行编码为完整的请求帧写入语料文件, -n 限制帧数\n"
+        "   --corpus=<FILE>      发送预编码语料中的请求帧, 只改写 reqid, 代替 -m -a -e 与 --scenario\n"
+        "   --search=<c|qps>:<LO>:<HI>  最大吞吐搜索: 在区间内逐档调整 -c 或 -R, 每档按 -w -d 压测一轮, 输出每档结果与满足 --slo 的拐点\n"
+        "   --slo=<pNN<LATENCY[,err<PCT%]>  搜索的 SLO, 如 p99<50ms,err<0.1%, 失败率上限默认 0.1%\n"
+        "   --profile=<qps|c>:<T>=<V>[@NAME],...  负载曲线, 如 qps:0=100,5m=5000,5m=20000@spike,6m=20000,10m=1000, 相邻两点线性变化, 同一时刻两点为阶跃, 区间统计按阶段标记\n"
+        "   --record=<FILE>      录制压测中收发的原始 Dubbo 帧 (时间戳/连接/方向/reqid), 可用于 --replay\n"
+        "   --replay=<FILE>      按原始时间间隔回放录制文件中的请求帧, 改写 reqid, 原始连接分布到 -C 条连接 (默认同原始连接数), 需 -c, 发完即结束或按 -d 截断\n"
+        "   --replay-speed=<X>   回放倍速, 如 2 5x 0.5x, 默认 1; 同样用于 --qps-series 的时间压缩\n"
+        "   --qps-series=<FILE>  按监控导出的 \"秒,qps\" CSV 开环发送, 秒内线性插值, 请求仍由 -a 或 --scenario 生成, 需 -c\n"
+        "   -d<DURATION>         压测时长, 如 60s 5m 500ms, 不带单位为秒; 与 -n 同时指定时先到先结束\n"
+        "   -w<WARMUP>           预热时长, 所有连接建立或首次建连失败后开始计时, 期间完成的请求不计入统计\n"
+        "   --hist-out=<FILE>    输出 HdrHistogram 格式的完整延迟分布(ms), - 为标准输出\n"
+        "   --req-timeout=<MS>   单个请求超时, 超时计为客户端超时并释放 pipeline, 默认同 -t\n"
+        "   --heartbeat=<DURATION>  连接空闲超过该时长发送心跳, 3 倍时长没有收到数据则重连, 默认 60s, 0 为关闭\n"
+        "   --ping[=<INTERVAL>]  不压测, 按间隔 (默认 1s) 向每个 provider 发送心跳事件, 按 --report-interval 输出各 provider 的 RTT 分布/丢失/抖动, -n 为探测次数, -d 为时长, 超时同 --req-timeout, 无需 -m -a\n"
+        "   --report-interval=<DURATION>  按间隔输出区间统计 (时间戳/成功/失败/QPS/在途/延迟分位), 默认 1s\n"
+        "   --report-out=<FILE>  区间统计输出文件, - 为标准错误 (默认)\n"
+        "   --report-format=<csv|json>  区间统计格式, 默认 csv, json 为每行一个 JSON 对象\n"
+        "   --json-out=<FILE>    输出 JSON 格式的完整压测结果 (配置/时长/结果计数/吞吐/流量/延迟分位), - 为标准输出\n\n"
         "Example:\n"
         "   ./dubbo_test -h10.215.21.21 -p20983 -mcom.youzan.generic.service.DemoService.complexMethod -a'[true,42,3.14,\"hello\",{}, [],[],{},\"DEBUG\"]'\n";
     puts(usage);
@@ -63,13 +162,308 @@ static char *trim_opt(char *opt)
     return opt;
 }
 
+// 时长参数: 60s 5m 1h 500ms, 不带单位为秒, 非法返回 -1
+static long parse_duration_ms(const char *opt)
+{
+    char *end = NULL;
+    double val = strtod(opt, &end);
+    if (end == opt || val < 0)
+    {
+        return -1;
+    }
+    if (*end == 0 || strcmp(end, "s") == 0)
+    {
+        return (long)(val * 1000);
+    }
+    else if (strcmp(end, "ms") == 0)
+    {
+        return (long)val;
+    }
+    else if (strcmp(end, "m") == 0)
+    {
+        return (long)(val * 60 * 1000);
+    }
+    else if (strcmp(end, "h") == 0)
+    {
+        return (long)(val * 3600 * 1000);
+    }
+    return -1;
+}
+
+// c:LO:HI 或 qps:LO:HI
+static bool parse_search(const char *opt, struct dubbo_async_args *async_args)
+{
+    char mode[8];
+    double lo = 0, hi = 0;
+    int n = 0;
+    if (sscanf(opt, "%7[a-z]:%lf:%lf%n", mode, &lo, &hi, &n) != 3 || opt[n] != 0)
+    {
+        return false;
+    }
+    if (strcmp(mode, "c") == 0)
+    {
+        async_args->search = BENCH_SEARCH_CONC;
+        if (lo < 1)
+        {
+            return false;
+        }
+    }
+    else if (strcmp(mode, "qps") == 0)
+    {
+        async_args->search = BENCH_SEARCH_RATE;
+    }
+    else
+    {
+        return false;
+    }
+    async_args->search_lo = lo;
+    async_args->search_hi = hi;
+    return lo > 0 && hi >= lo;
+}
+
+// p99<50ms,err<0.1%, 延迟单位 us/ms/s, 不带单位为 ms
+static bool parse_slo(char *opt, struct dubbo_async_args *async_args)
+{
+    char *saveptr = NULL;
+    for (char *item = strtok_r(opt, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr))
+    {
+        char *lt = strchr(item, '<');
+        if (lt == NULL)
+        {
+            return false;
+        }
+        *lt = 0;
+        char *val = lt[1] == '=' ? lt + 2 : lt + 1;
+        char *end = NULL;
+        double v = strtod(val, &end);
+        if (end == val || v < 0)
+        {
+            return false;
+        }
+
+        if (strcmp(item, "err") == 0)
+        {
+            if (*end != 0 && strcmp(end, "%") != 0)
+            {
+                return false;
+            }
+            async_args->slo_err_pct = v;
+        }
+        else if (item[0] == 'p')
+        {
+            char *pend = NULL;
+            double pct = strtod(item + 1, &pend);
+            if (pend == item + 1 || *pend != 0 || pct <= 0 || pct > 100)
+            {
+                return false;
+            }
+            async_args->slo_pct = pct;
+            if (*end == 0 || strcmp(end, "ms") == 0)
+            {
+                async_args->slo_lat_ms = v;
+            }
+            else if (strcmp(end, "us") == 0)
+            {
+                async_args->slo_lat_ms = v / 1000;
+            }
+            else if (strcmp(end, "s") == 0)
+            {
+                async_args->slo_lat_ms = v * 1000;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return async_args->slo_pct > 0;
+}
+
+// qps:T=V[@NAME],... 或 c:T=V[@NAME],..., 时间格式同 -d, 原地切分 opt
+static struct profile *parse_profile(char *opt)
+{
+    char *colon = strchr(opt, ':');
+    if (colon == NULL)
+    {
+        return NULL;
+    }
+    *colon = 0;
+    enum profile_kind kind;
+    if (strcmp(opt, "qps") == 0)
+    {
+        kind = PROFILE_RATE;
+    }
+    else if (strcmp(opt, "c") == 0)
+    {
+        kind = PROFILE_CONC;
+    }
+    else
+    {
+        return NULL;
+    }
+
+    struct profile *p = profile_create(kind);
+    char *saveptr = NULL;
+    for (char *item = strtok_r(colon + 1, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr))
+    {
+        char *eq = strchr(item, '=');
+        if (eq == NULL)
+        {
+            profile_release(p);
+            return NULL;
+        }
+        *eq = 0;
+        char *name = strchr(eq + 1, '@');
+        if (name)
+        {
+            *name++ = 0;
+        }
+        char *end = NULL;
+        double val = strtod(eq + 1, &end);
+        long t_ms = parse_duration_ms(item);
+        if (end == eq + 1 || *end != 0 || t_ms < 0 || !profile_add(p, t_ms, val, name))
+        {
+            profile_release(p);
+            return NULL;
+        }
+    }
+    if (p->point_n == 0 || profile_max(p) <= 0)
+    {
+        profile_release(p);
+        return NULL;
+    }
+    return p;
+}
+
+// host[:port][@weight],... 原地切分 opt
+// 连接只支持 IPv4; 按最后一个 ':' 切分端口时 IPv6 地址会被误拆, 含多个 ':' 或 '[' 的目标直接拒绝
+static bool has_ipv6_target(const char *opt)
+{
+    int colon_n = 0;
+    for (const char *c = opt; *c; c++)
+    {
+        if (*c == ',')
+        {
+            colon_n = 0;
+        }
+        else if (*c == '[' || (*c == ':' && ++colon_n > 1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static struct dubbo_target *parse_targets(char *opt, char *default_port, int *target_n)
+{
+    int cap = 1;
+    for (char *c = opt; *c; c++)
+    {
+        if (*c == ',')
+        {
+            cap++;
+        }
+    }
+    struct dubbo_target *targets = calloc(cap, sizeof(*targets));
+    if (targets == NULL)
+    {
+        return NULL;
+    }
+
+    int n = 0;
+    char *saveptr = NULL;
+    for (char *item = strtok_r(opt, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr))
+    {
+        struct dubbo_target *t = &targets[n];
+        t->weight = 1;
+        char *at = strchr(item, '@');
+        if (at)
+        {
+            *at = 0;
+            t->weight = atoi(at + 1);
+            if (t->weight <= 0)
+            {
+                free(targets);
+                return NULL;
+            }
+        }
+        char *colon = strrchr(item, ':');
+        if (colon)
+        {
+            *colon = 0;
+            t->port = colon + 1;
+        }
+        else
+        {
+            t->port = default_port;
+        }
+        t->host = item;
+        if (*t->host == 0 || t->port == NULL || *t->port == 0)
+        {
+            free(targets);
+            return NULL;
+        }
+        n++;
+    }
+    if (n == 0)
+    {
+        free(targets);
+        return NULL;
+    }
+    *target_n = n;
+    return targets;
+}
+
+// 语料中的方法名, 结构同场景文件中的方法, 参数为空
+static struct dubbo_method *corpus_methods(const char *path, int *method_n)
+{
+    struct corpus *c = corpus_open(path);
+    if (c == NULL)
+    {
+        return NULL;
+    }
+    int n = corpus_method_n(c);
+    struct dubbo_method *methods = calloc(n, sizeof(*methods));
+    assert(methods);
+    for (int i = 0; i < n; i++)
+    {
+        struct dubbo_method *m = &methods[i];
+        m->service = strdup(corpus_method_name(c, i));
+        char *dot = strrchr(m->service, '.');
+        if (dot)
+        {
+            *dot = 0;
+            m->method = dot + 1;
+        }
+        else
+        {
+            m->method = m->service + strlen(m->service);
+        }
+        m->args = strdup("[]");
+        m->attach = strdup("{}");
+        m->weight = 1;
+    }
+    corpus_close(c);
+    *method_n = n;
+    return methods;
+}
+
 int main(int argc, char **argv)
 {
     struct dubbo_async_args async_args;
     memset(&async_args, 0, sizeof(async_args));
     async_args.req_n = 0;
     async_args.pipe_n = 0;
+    async_args.conn_n = 1;
+    async_args.thread_n = 1;
     async_args.verbos = false;
+    async_args.slo_err_pct = 0.1;
+    async_args.replay_speed = 1;
+    async_args.heartbeat_ms = 60000;
 
     struct dubbo_args args;
     memset(&args, 0, sizeof(args));
@@ -77,8 +471,12 @@ int main(int argc, char **argv)
     args.timeout.tv_sec = 3;
     args.timeout.tv_usec = 0;
 
+    bool report_on = false;
+    char *scenario = NULL;
+    char *compile_out = NULL;
+    bool conn_set = false;
     int opt = 0;
-    opt = getopt(argc, argv, optString);
+    opt = getopt_long(argc, argv, optString, longOpts, NULL);
     optarg = trim_opt(optarg);
     while (opt != -1)
     {
@@ -111,54 +509,276 @@ int main(int argc, char **argv)
         case 'c':
             async_args.pipe_n = atoi(optarg);
             break;
+        case 'C':
+            async_args.conn_n = atoi(optarg);
+            conn_set = true;
+            break;
+        case 'T':
+            async_args.thread_n = atoi(optarg);
+            break;
         case 'n':
             async_args.req_n = atoi(optarg);
             break;
+        case 'd':
+            async_args.duration_ms = parse_duration_ms(optarg);
+            ASSERT_OPT(async_args.duration_ms >= 0, "Invalid duration %s", optarg);
+            break;
+        case 'w':
+            async_args.warmup_ms = parse_duration_ms(optarg);
+            ASSERT_OPT(async_args.warmup_ms >= 0, "Invalid warmup %s", optarg);
+            break;
+        case 'R':
+            async_args.rate = atof(optarg);
+            break;
         case 'v':
             async_args.verbos = true;
             break;
+        case OPT_HIST_OUT:
+            async_args.hist_out = optarg;
+            break;
+        case OPT_REQ_TIMEOUT:
+            async_args.req_timeout_ms = atol(optarg);
+            break;
+        case OPT_REPORT_INTERVAL:
+            async_args.report_interval_ms = parse_duration_ms(optarg);
+            ASSERT_OPT(async_args.report_interval_ms > 0, "Invalid report interval %s", optarg);
+            break;
+        case OPT_REPORT_OUT:
+            async_args.report_out = optarg;
+            break;
+        case OPT_REPORT_FORMAT:
+            ASSERT_OPT(report_fmt_parse(optarg, &async_args.report_fmt), "Invalid report format %s", optarg);
+            report_on = true;
+            break;
+        case OPT_JSON_OUT:
+            async_args.json_out = optarg;
+            break;
+        case OPT_SCENARIO:
+            scenario = optarg;
+            break;
+        case OPT_DATASET:
+            async_args.dataset = optarg;
+            break;
+        case OPT_DATASET_SHUFFLE:
+            async_args.dataset_shuffle = true;
+            break;
+        case OPT_DATASET_WRAP:
+            async_args.dataset_wrap = true;
+            break;
+        case OPT_COMPILE_CORPUS:
+            compile_out = optarg;
+            break;
+        case OPT_CORPUS:
+            async_args.corpus = optarg;
+            break;
+        case OPT_SEED:
+            async_args.seed = strtoull(optarg, NULL, 10);
+            break;
+        case OPT_PROFILE:
+            async_args.profile = parse_profile(optarg);
+            ASSERT_OPT(async_args.profile, "Invalid profile, expect e.g. qps:0=100,1m=5000 or c:0=1,30s=64");
+            break;
+        case OPT_RECORD:
+            async_args.record = optarg;
+            break;
+        case OPT_REPLAY:
+            async_args.replay_path = optarg;
+            break;
+        case OPT_QPS_SERIES:
+            async_args.qps_series = optarg;
+            break;
+        case OPT_HEARTBEAT:
+            async_args.heartbeat_ms = parse_duration_ms(optarg);
+            ASSERT_OPT(async_args.heartbeat_ms >= 0, "Invalid heartbeat interval %s", optarg);
+            break;
+        case OPT_PING:
+            async_args.ping_interval_ms = optarg && *optarg ? parse_duration_ms(optarg) : 1000;
+            ASSERT_OPT(async_args.ping_interval_ms > 0, "Invalid ping interval %s", optarg);
+            break;
+        case OPT_REPLAY_SPEED:
+        {
+            char *end;
+            async_args.replay_speed = strtod(optarg, &end);
+            ASSERT_OPT(end != optarg && (*end == 0 || strcmp(end, "x") == 0) && async_args.replay_speed > 0,
+                       "Invalid replay speed %s, expect e.g. 1 2x 0.5x", optarg);
+        }
+        break;
+        case OPT_SEARCH:
+            ASSERT_OPT(parse_search(optarg, &async_args), "Invalid search %s, expect c:LO:HI or qps:LO:HI", optarg);
+            break;
+        case OPT_SLO:
+            ASSERT_OPT(parse_slo(optarg, &async_args), "Invalid slo %s, expect e.g. p99<50ms,err<0.1%%", optarg);
+            break;
+        case OPT_BALANCE:
+            ASSERT_OPT(balance_parse(optarg, &async_args.balance), "Invalid balance %s", optarg);
+            break;
         case '?':
             usage();
             break;
         default:
             break;
         }
-        opt = getopt(argc, argv, optString);
+        opt = getopt_long(argc, argv, optString, longOpts, NULL);
         optarg = trim_opt(optarg);
     }
 
-    ASSERT_OPT(args.host, "Missing Host -h=${host}");
-    ASSERT_OPT(args.port, "Missing Port -p=${port}");
+    // 编译语料不连接 provider
+    if (compile_out == NULL)
+    {
+        ASSERT_OPT(args.host, "Missing Host -h=${host}");
+        ASSERT_OPT(!has_ipv6_target(args.host), "IPv6 address is not supported -h=%s", args.host);
+        args.targets = parse_targets(args.host, args.port, &args.target_n);
+        ASSERT_OPT(args.targets, "Invalid Host or Missing Port -h=${host}[:${port}][@${weight}],... -p=${port}");
+        args.host = args.targets[0].host;
+        args.port = args.targets[0].port;
+    }
+    // 心跳探测不调用服务, 不需要方法与参数
+    if (async_args.ping_interval_ms > 0)
+    {
+        ASSERT_OPT(async_args.req_timeout_ms >= 0, "Request timeout must be positive");
+        return dubbo_ping(&args, &async_args) ? 0 : 1;
+    }
+    struct dubbo_method single;
+    if (async_args.replay_path)
+    {
+        ASSERT_OPT(compile_out == NULL && scenario == NULL && async_args.dataset == NULL && async_args.corpus == NULL,
+                   "--replay conflicts with --compile-corpus, --scenario, --dataset and --corpus");
+        async_args.replay = replay_open(async_args.replay_path);
+        ASSERT_OPT(async_args.replay, "Invalid Capture File %s", async_args.replay_path);
+        // 录制帧自带服务与参数, 以文件名作为唯一的方法
+        args.service = async_args.replay_path;
+        args.method = "";
+        args.args = "[]";
+        if (!conn_set)
+        {
+            // 原始连接数均分到各 provider
+            async_args.conn_n = (replay_conn_n(async_args.replay) + args.target_n - 1) / args.target_n;
+        }
+    }
+    if (async_args.corpus)
+    {
+        ASSERT_OPT(compile_out == NULL && scenario == NULL && async_args.dataset == NULL, "--corpus conflicts with --compile-corpus, --scenario and --dataset");
+        ASSERT_OPT(async_args.req_n > 0 || async_args.duration_ms > 0, "--corpus requires -n or -d");
+        args.methods = corpus_methods(async_args.corpus, &args.method_n);
+        ASSERT_OPT(args.methods, "Invalid Corpus File %s", async_args.corpus);
+        args.service = args.methods[0].service;
+        args.method = args.methods[0].method;
+        args.args = args.methods[0].args;
+        args.attach = args.methods[0].attach;
+    }
+    else if (scenario)
+    {
+        args.methods = scenario_load(scenario, &args.method_n);
+        ASSERT_OPT(args.methods, "Invalid Scenario File %s", scenario);
+        args.service = args.methods[0].service;
+        args.method = args.methods[0].method;
+        args.args = args.methods[0].args;
+        args.attach = args.methods[0].attach;
+    }
     ASSERT_OPT(args.service, "Missing Service -m=${service}.${method}");
     ASSERT_OPT(args.method, "Missing Method -m=${service}.${method}");
     ASSERT_OPT(args.args, "Missing Arguments -a'${jsonargs}'");
+    if (scenario == NULL && async_args.corpus == NULL)
+    {
+        single.service = args.service;
+        single.method = args.method;
+        single.args = args.args;
+        single.attach = args.attach;
+        single.weight = 1;
+        args.methods = &single;
+        args.method_n = 1;
+    }
     ASSERT_OPT(args.timeout.tv_sec > 0, "Timeout must be positive");
+    ASSERT_OPT(async_args.conn_n > 0, "Connections must be positive");
+    ASSERT_OPT(async_args.thread_n > 0, "Threads must be positive");
+    // -C 为每个 provider 的连接数, 总连接数为 conn_n * target_n; 编译语料不连接 provider
+    ASSERT_OPT(compile_out || async_args.thread_n <= async_args.conn_n * args.target_n, "Total connections (-C * providers) must be >= threads");
+    ASSERT_OPT(async_args.rate >= 0, "Target QPS must be positive");
+    ASSERT_OPT(async_args.req_timeout_ms >= 0, "Request timeout must be positive");
+
+    // 指定任一区间统计参数即开启, 其余取默认值
+    if (report_on || async_args.report_out || async_args.report_interval_ms > 0)
+    {
+        if (async_args.report_interval_ms == 0)
+        {
+            async_args.report_interval_ms = 1000;
+        }
+        if (async_args.report_out == NULL)
+        {
+            async_args.report_out = "-";
+        }
+    }
 
-    cJSON *json_args = cJSON_Parse(args.args);
-    ASSERT_OPT(json_args && (cJSON_IsObject(json_args) || cJSON_IsArray(json_args)), "Invalid Arguments JSON Format : %s", args.args);
-    cJSON_Delete(json_args);
+    // 参数模板在加载数据集后以首行渲染校验
+    if (strstr(args.args, "{{") == NULL)
+    {
+        cJSON *json_args = cJSON_Parse(args.args);
+        ASSERT_OPT(json_args && (cJSON_IsObject(json_args) || cJSON_IsArray(json_args)), "Invalid Arguments JSON Format : %s", args.args);
+        cJSON_Delete(json_args);
+    }
 
     cJSON *json_attach = cJSON_Parse(args.attach);
     ASSERT_OPT(json_attach && cJSON_IsObject(json_attach), "Invalid Attach JSON Format as %s", args.attach);
     cJSON_Delete(json_attach);
 
+    if (compile_out)
+    {
+        ASSERT_OPT(async_args.dataset || async_args.req_n > 0, "--compile-corpus requires --dataset or -n");
+        ASSERT_OPT(!async_args.dataset_wrap || async_args.req_n > 0, "--compile-corpus with --dataset-wrap requires -n");
+        return dubbo_compile_corpus(&args, &async_args, compile_out) ? 0 : 1;
+    }
+
     // fprintf(stderr, "Invoking dubbo://%s:%s/%s.%s?args=%s&attach=%s\n", args.host, args.port, args.service, args.method, args.args, args.attach);
 
-    if (async_args.req_n > 0 && async_args.pipe_n > 0)
+    // QPS 序列转为开环负载曲线, 倍速在所有选项解析后才确定
+    if (async_args.qps_series)
+    {
+        ASSERT_OPT(async_args.profile == NULL && async_args.replay == NULL, "--qps-series conflicts with --profile and --replay");
+        async_args.profile = profile_load_series(async_args.qps_series, async_args.replay_speed);
+        ASSERT_OPT(async_args.profile, "Invalid QPS Series File %s", async_args.qps_series);
+    }
+
+    // 按负载曲线压测: 时长默认到曲线最后一点, 开环以峰值作为名义 qps, 闭环以峰值作为单连接 pipeline 深度
+    if (async_args.profile)
     {
-        async_args.el = aeCreateEventLoop(1024);
-        if (dubbo_bench_async(&args, &async_args))
+        ASSERT_OPT(async_args.rate == 0 && async_args.search == BENCH_SEARCH_NONE, "--profile conflicts with -R and --search");
+        if (async_args.duration_ms == 0)
         {
-            aeMain(async_args.el);
-            aeDeleteEventLoop(async_args.el);
-            return 0;
+            async_args.duration_ms = profile_duration_ms(async_args.profile);
+        }
+        ASSERT_OPT(async_args.duration_ms > 0, "--profile with a single point requires -d");
+        if (async_args.profile->kind == PROFILE_RATE)
+        {
+            ASSERT_OPT(async_args.pipe_n > 0, "--profile=qps requires -c as the max inflight per connection");
+            async_args.rate = profile_max(async_args.profile);
         }
         else
         {
-            aeDeleteEventLoop(async_args.el);
-            return 1;
+            async_args.pipe_n = (int)(profile_max(async_args.profile) + 0.999);
         }
     }
+
+    // 回放按录制的时间表发送, 发完即结束
+    if (async_args.replay)
+    {
+        ASSERT_OPT(async_args.rate == 0 && async_args.profile == NULL && async_args.search == BENCH_SEARCH_NONE && async_args.req_n == 0,
+                   "--replay conflicts with -R, --profile, --search and -n");
+        ASSERT_OPT(async_args.pipe_n > 0, "--replay requires -c as the max inflight per connection");
+    }
+
+    if (async_args.search != BENCH_SEARCH_NONE)
+    {
+        ASSERT_OPT(async_args.slo_pct > 0, "--search requires --slo");
+        ASSERT_OPT(async_args.record == NULL, "--record conflicts with --search");
+        ASSERT_OPT(async_args.duration_ms > 0, "--search requires -d as the duration of each step");
+        ASSERT_OPT(async_args.search == BENCH_SEARCH_CONC || async_args.pipe_n > 0, "--search=qps requires -c as the max inflight per connection");
+        return dubbo_bench_search(&args, &async_args) ? 0 : 1;
+    }
+
+    if ((async_args.req_n > 0 || async_args.duration_ms > 0 || async_args.replay) && async_args.pipe_n > 0)
+    {
+        return dubbo_bench_async(&args, &async_args) ? 0 : 1;
+    }
     else
     {
         return dubbo_invoke_sync(&args) ? 0 : 1;
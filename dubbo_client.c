@@ -3,46 +3,262 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/time.h>
+#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
-#include <signal.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <inttypes.h> /* PRId64 */
 
 #include "dubbo_codec.h"
 #include "dubbo_client.h"
+#include "dubbo_conn.h"
 #include "socket.h"
 #include "buffer.h"
+#include "histogram.h"
+#include "inflight.h"
+#include "balance.h"
+#include "alias.h"
+#include "dataset.h"
+#include "argtpl.h"
+#include "corpus.h"
+#include "topk.h"
+#include "profile.h"
+#include "capture.h"
+#include "replay.h"
+#include "rng.h"
 #include "log.h"
 
 #include "lib/ae/ae.h"
 #include "lib/cJSON.h"
 
 #define CLI_INIT_BUF_SZ 1024
+#define BENCH_CHECK_STOP_MS 100
+#define BENCH_RATE_TICK_MS 1
+#define BENCH_EXPIRE_TICK_MS 10
+#define BENCH_REQ_UNLIMITED INT64_MAX
+#define BENCH_REPORT_LOOP_SZ 64
+#define BENCH_ERROR_TOPK 32
+#define BENCH_ERROR_SHOW_N 10
+#define BENCH_PROFILE_TICK_MS 10
+#define BENCH_HEARTBEAT_CHECK_N 3   /* 每个心跳间隔检查 3 次空闲, 同 Dubbo */
+#define BENCH_HEARTBEAT_TIMEOUT_N 3 /* 超过 3 个心跳间隔没有收到数据则重连, 同 Dubbo */
+#define BENCH_SEARCH_MAX_STEPS 16
+#define BENCH_SEARCH_PRECISION 0.05 /* 目标 qps 二分到上下界相差 5% 为止 */
+#define BENCH_RECONNECT_MIN_MS 100   /* 连续重连失败的退避, 从 100ms 翻倍到 3s, 建连成功后清零 */
+#define BENCH_RECONNECT_MAX_MS 3000
+
+// 当前线程的压测实例, 供 beforesleep 回调使用
+static __thread struct dubbo_bench *t_bench;
+
+// 请求结果分类: 响应按状态码与结果类型, 另有本地超时/连接错误/解码错误
+enum bench_outcome
+{
+    OUTCOME_OK,
+    OUTCOME_EXCEPTION, /* 状态码 OK, 结果为业务异常 */
+    OUTCOME_CLIENT_TIMEOUT,
+    OUTCOME_SERVER_TIMEOUT,
+    OUTCOME_BAD_REQUEST,
+    OUTCOME_BAD_RESPONSE,
+    OUTCOME_SERVICE_NOT_FOUND,
+    OUTCOME_SERVICE_ERROR,
+    OUTCOME_SERVER_ERROR,
+    OUTCOME_CLIENT_ERROR,
+    OUTCOME_STATUS_OTHER, /* 未定义的状态码 */
+    OUTCOME_TIMEOUT,      /* 本地请求超时, 未收到响应 */
+    OUTCOME_CONN_ERROR,   /* 连接出错时未完成的请求, 配额归还后重发, 不计入 done_n */
+    OUTCOME_DECODE_ERROR, /* 无法解码的响应包, 随后重连 */
+    OUTCOME_N,
+};
 
-static struct dubbo_client *g_cli;
+static const char *outcome_names[OUTCOME_N] = {
+    "OK",
+    "EXCEPTION",
+    "CLIENT_TIMEOUT",
+    "SERVER_TIMEOUT",
+    "BAD_REQUEST",
+    "BAD_RESPONSE",
+    "SERVICE_NOT_FOUND",
+    "SERVICE_ERROR",
+    "SERVER_ERROR",
+    "CLIENT_ERROR",
+    "STATUS_OTHER",
+    "TIMEOUT",
+    "CONN_ERROR",
+    "DECODE_ERROR",
+};
 
-struct dubbo_client
+struct bench_stats
+{
+    int64_t ok_n;
+    int64_t ko_n;
+    int64_t timeout_n;   /* 超时未响应 */
+    int64_t unmatched_n; /* 重复或超时后到达的响应 */
+    int64_t reorder_n;   /* 同一连接上乱序到达的响应 */
+    int64_t done_n;      /* 统计窗口内完成的请求数, 含超时 */
+    int64_t send_n;      /* 发送请求数 */
+    int64_t write_n;     /* write 系统调用次数 */
+    int64_t bytes_in;    /* 统计窗口内接收字节数 */
+    int64_t bytes_out;   /* 统计窗口内发送字节数 */
+    int64_t outcome_n[OUTCOME_N];
+    struct hist *lat;    /* 成功请求的延迟, 单位 us */
+    struct hist *lat_ko; /* 失败响应的延迟, 快速失败不拉低成功延迟 */
+};
+
+// 各线程共享只读的请求负载
+struct bench_workload
+{
+    struct buffer **frames; /* 每个方法预编码的请求帧 */
+    int method_n;
+    struct alias *mix; /* 按权重抽取方法, 只有一个方法时为 NULL */
+
+    // 参数含占位符的方法逐个请求渲染参数, 不使用预编码的请求帧; 未引用时对应下标为 NULL
+    struct dataset *data;
+    struct argtpl **tpls;
+    struct dubbo_req_tpl **req_tpls;
+
+    bool templated; /* 有方法使用参数模板 */
+
+    // 预编码语料, 每帧自带方法下标, 不再按权重抽样与编码
+    struct corpus *corpus;
+
+    // 回放的录制请求帧, 统一计入一个方法; 归 async_args 所有
+    const struct replay *replay;
+};
+
+// 回放队列中的一帧与其映射到的连接
+struct bench_replay_item
+{
+    const struct replay_frame *frame;
+    struct dubbo_client *cli;
+};
+
+// 一个 provider 在本线程内的连接与统计
+struct bench_target
+{
+    int idx;
+    union sockaddr_all addr;
+
+    // 已连接且有空闲 pipeline 的连接, 从头部取用后移到尾部, 依次轮换
+    struct dubbo_client *ready_head;
+    struct dubbo_client *ready_tail;
+
+    struct bench_stats stats;
+};
+
+// 压测工作线程: 独占一个 event loop, 其上的 N 个连接共享请求配额与统计, 线程间不共享状态
+struct dubbo_bench
 {
+    int id;
+    int thread_n;
+    pthread_t tid;
     struct aeEventLoop *el;
     struct dubbo_args *args;
-    union sockaddr_all addr;
+    const struct bench_workload *wl;
+    uint64_t rng;
     long timeout_ms;
-    long long timerid;
+    long long stop_timerid;
+
+    struct dubbo_client **clis;
+    int cli_n;
+
+    // 各 provider 按下标与 lb.nodes 一一对应
+    struct bench_target *targets;
+    int target_n;
+    struct lb lb;
+
+    // 本轮事件循环中有待发送数据的连接, 进入 poll 前统一 write
+    struct dubbo_client **flush_q;
+    int flush_n;
+    int flush_cap;
+
+    int64_t reqid_begin;
+    int64_t reqid_end;
 
-    struct buffer *rcv_buf;
-    struct buffer *snd_buf;
     int pipe_n;
-    int pipe_left;
-    int req_n;
-    int req_left;
-    int ok_n;
-    int ko_n;
+    int64_t req_n;     /* 仅按时长结束时为 BENCH_REQ_UNLIMITED */
+    int64_t req_left;  /* 未收到响应的请求数 */
+    int64_t send_left; /* 未发送的请求数 */
+    struct bench_stats *mstats; /* 按方法统计, 下标同 wl->frames */
+    int64_t conc_left; /* 闭环模式剩余并发额度, 多个 provider 时少于连接 pipeline 总和, 由均衡策略决定去向 */
+    struct bench_stats stats;
+
+    // 数据集游标, 预取下一行; 不循环时读完即停止发送, 未使用数据集时为 NULL
+    struct dataset_cursor *cursor;
+    const char *row;
+    size_t row_len;
+    bool data_done;
+    struct buffer *args_buf; /* 渲染参数的临时缓冲, 没有参数模板时为 NULL */
+    struct argtpl_ctx tpl_ctx;
+
+    // 语料中本线程负责的帧 [corpus_begin, corpus_end), 读完同数据集
+    uint64_t corpus_begin;
+    uint64_t corpus_end;
+    uint64_t corpus_pos;
+    bool corpus_wrap;
+
+    // 统计窗口: 所有连接首次建连有结果 (建立或失败) 且预热结束后开启, 持续 duration_ms, 窗口外完成的请求不计入统计
+    long warmup_ms;
+    long duration_ms;
+    long long window_timerid;
+    int connected_n;
+    int settled_n; /* 首次建连已有结果的连接数 */
+    bool measuring; /* 主线程原子读 */
+    struct conn_io io;      /* 所有连接的读写计数 */
+    struct conn_io io_base; /* 开启统计窗口时的 io, 字节数只计窗口内 */
+
+    // 区间统计, 主线程按间隔取走并清零, 预热期间的请求同样计入; 未开启时 ival.lat 为 NULL
+    pthread_mutex_t ival_lock;
+    struct bench_stats ival;
+    struct hist *ival_spare; /* 仅主线程使用, 与 ival.lat 交换 */
+    int ival_inflight;       /* 原子读写 */
+    int finished;            /* 原子读写, 线程退出前置 1 */
+
+    // 失败响应按异常类名或错误信息归类
+    struct topk *errors;
+
+    // 流量录制, 未开启时为 NULL
+    struct capture_buf *capture;
+
+    // 空闲连接心跳: 超过 hb_us 没有读或写则发送心跳事件, 不计入请求统计; 未开启时 hb_frame 为 NULL
+    struct buffer *hb_frame;
+    uint64_t hb_us;
+    long long hb_timerid;
+    int64_t hb_sent;
+    int64_t hb_acked;
+    int64_t hb_replied; /* 应答 provider 的心跳 */
+
+    // 已发送未响应的请求, 超时则计为客户端超时并释放 pipeline
+    struct inflight *inflight;
+    uint64_t req_timeout_us;
+    long long expire_timerid;
+
+    // 流量回放: 本线程连接上的录制帧按原始时间排列, 预期发送时间为 replay_t0 + off_us / replay_speed
+    // 队首帧的连接未建立或 pipeline 已满时整体等待, 保持原始发送顺序; 未回放时 replay_lag 为 NULL
+    struct bench_replay_item *replay_q;
+    uint64_t replay_n;
+    uint64_t replay_pos;
+    double replay_speed;
+    uint64_t replay_t0;
+    struct hist *replay_lag; /* 实际发送落后预期的时间, 单位 us */
+
+    // 开环定速模式: 下一个请求的预期发送时间为 rate_t0 + rate_next_us, 每发送一个推进 rate_interval_us
+    double rate; /* 按负载曲线发送时为曲线峰值 */
+    double rate_interval_us; /* 0 为暂停发送 */
+    uint64_t rate_t0;
+    double rate_next_us;
+    long long rate_timerid; /* 回放同样使用 */
+
+    // 负载曲线: 统计窗口开启后开始计时, 定时调整 rate_interval_us 或闭环并发额度; 未指定时为 NULL
+    const struct profile *profile;
+    uint64_t profile_t0;
+    int64_t conc_cap; /* 闭环模式当前并发额度上限 */
+    int phase;        /* 原子读写, 当前阶段 */
+    long long profile_timerid;
 
-    int fd;
-    bool connected;
     bool run;
     bool verbos;
 
@@ -50,501 +266,2619 @@ struct dubbo_client
     struct timeval end;
 };
 
-static void cli_on_connect(struct aeEventLoop *el, int fd, void *ud, int mask);
-static void cli_on_read(struct aeEventLoop *el, int fd, void *ud, int mask);
-static void cli_on_write(struct aeEventLoop *el, int fd, void *ud, int mask);
+// 单个连接
+struct dubbo_client
+{
+    struct dubbo_bench *bench;
+    struct bench_target *target;
+    int id;
+    struct conn conn;
+
+    int pipe_left;
+    int64_t last_reqid; /* 最近收到响应的 reqid, 用于检测乱序 */
+    bool flush_pending;
+
+    struct dubbo_client *ready_prev;
+    struct dubbo_client *ready_next;
+    bool ready;
+
+    bool settled;    /* 首次建连已有结果 */
+    long backoff_ms; /* 下次重连的等待时间, 0 为立即重连 */
+    long long retry_timerid;
+};
+
+static void cli_on_connect(struct conn *c);
+static bool cli_on_frame(struct conn *c, size_t len);
+static void cli_on_frames(struct conn *c, int frame_n);
+static void cli_on_error(struct conn *c, enum conn_err err, int sys_errno);
+
+static const struct conn_ops cli_conn_ops = {
+    .on_connect = cli_on_connect,
+    .on_frame = cli_on_frame,
+    .on_frames = cli_on_frames,
+    .on_error = cli_on_error,
+};
 
-static void cli_pipe_send(struct dubbo_client *cli);
-static bool cli_start(struct dubbo_client *cli);
-static void cli_end(struct dubbo_client *cli);
+static void bench_pipe_send(struct dubbo_bench *bench);
+static void bench_fill(struct dubbo_bench *bench);
+static void bench_rate_send(struct dubbo_bench *bench);
+static void bench_replay_send(struct dubbo_bench *bench);
+static bool bench_start(struct dubbo_bench *bench);
+static void bench_end(struct dubbo_bench *bench);
 
 static bool cli_decode_resp(struct dubbo_client *cli);
 static void cli_reconnect(struct dubbo_client *cli);
+static void cli_reconnect_later(struct dubbo_client *cli);
+static void cli_settle(struct dubbo_client *cli);
+static void cli_flush_later(struct dubbo_client *cli);
+static void bench_on_all_settled(struct dubbo_bench *bench);
+static void bench_profile_apply(struct dubbo_bench *bench);
+
+// 在途请求数供主线程区间统计读取
+static inline void bench_pub_inflight(struct dubbo_bench *bench)
+{
+    __atomic_store_n(&bench->ival_inflight, inflight_count(bench->inflight), __ATOMIC_RELAXED);
+}
 
-static struct buffer *cli_encode_req(struct dubbo_client *cli)
+static void bench_ival_record(struct dubbo_bench *bench, bool timeout, bool ok, uint64_t lat_us)
 {
-    struct dubbo_req *req = dubbo_req_create(cli->args->service, cli->args->method, cli->args->args, cli->args->attach);
-    if (req == NULL)
+    bench_pub_inflight(bench);
+    if (bench->ival.lat == NULL)
     {
-        return false;
+        return;
     }
-    if (cli->verbos)
+    pthread_mutex_lock(&bench->ival_lock);
+    if (timeout)
     {
-        printf("<req>[seq=%" PRId64 "]\n", dubbo_req_getid(req));
+        bench->ival.timeout_n++;
     }
-    return dubbo_encode(req);
-}
-
-static void cli_clear_timer(struct dubbo_client *cli)
-{
-    if (cli->timerid != AE_NOMORE)
+    else
     {
-        aeDeleteTimeEvent(cli->el, cli->timerid);
-        cli->timerid = AE_NOMORE;
+        if (ok)
+        {
+            bench->ival.ok_n++;
+            hist_record(bench->ival.lat, lat_us);
+        }
+        else
+        {
+            bench->ival.ko_n++;
+        }
     }
+    pthread_mutex_unlock(&bench->ival_lock);
 }
 
-static void cli_reset(struct dubbo_client *cli)
+static void bench_stats_init(struct bench_stats *stats)
 {
-    cli->connected = false;
-    cli_clear_timer(cli);
-    cli->fd = -1;
-    cli->pipe_left = cli->pipe_n;
-    buf_retrieveAll(cli->rcv_buf);
-    buf_retrieveAll(cli->snd_buf);
+    memset(stats, 0, sizeof(*stats));
+    stats->lat = hist_create();
+    stats->lat_ko = hist_create();
 }
 
-static struct dubbo_client *cli_create(struct dubbo_args *args, struct dubbo_async_args *async_args)
+static void bench_stats_destroy(struct bench_stats *stats)
 {
-    struct dubbo_client *cli = calloc(1, sizeof(*cli));
-    assert(cli);
-    cli->el = async_args->el;
-
-    cli->verbos = async_args->verbos;
-
-    cli->rcv_buf = buf_create(CLI_INIT_BUF_SZ);
-    cli->snd_buf = buf_create(CLI_INIT_BUF_SZ);
-
-    cli->req_n = async_args->req_n;
-    cli->req_left = async_args->req_n;
+    hist_release(stats->lat);
+    hist_release(stats->lat_ko);
+}
 
-    cli->pipe_n = async_args->pipe_n;
-    if (cli->pipe_n > cli->req_n)
+static void bench_stats_record(struct bench_stats *stats, enum bench_outcome outcome, uint64_t lat_us)
+{
+    stats->done_n++;
+    stats->outcome_n[outcome]++;
+    if (outcome == OUTCOME_OK)
     {
-        cli->pipe_n = cli->req_n;
+        stats->ok_n++;
+        hist_record(stats->lat, lat_us);
     }
-    cli->pipe_left = async_args->pipe_n;
-
-    cli->run = false;
-    cli->ok_n = 0;
-    cli->ko_n = 0;
+    else
+    {
+        stats->ko_n++;
+        hist_record(stats->lat_ko, lat_us);
+    }
+}
 
-    cli->timeout_ms = args->timeout.tv_sec * 1000;
-    cli->timerid = AE_NOMORE;
+static void bench_stats_timeout(struct bench_stats *stats)
+{
+    stats->timeout_n++;
+    stats->done_n++;
+    stats->outcome_n[OUTCOME_TIMEOUT]++;
+}
 
-    cli->args = args;
-    cli_reset(cli);
+static enum bench_outcome res_outcome(const struct dubbo_res_view *view)
+{
+    switch (view->status)
+    {
+    case DUBBO_RES_T_OK:
+        return view->type == DUBBO_RES_EX ? OUTCOME_EXCEPTION : OUTCOME_OK;
+    case DUBBO_RES_T_CLIENT_TIMEOUT:
+        return OUTCOME_CLIENT_TIMEOUT;
+    case DUBBO_RES_T_SERVER_TIMEOUT:
+        return OUTCOME_SERVER_TIMEOUT;
+    case DUBBO_RES_T_BAD_REQUEST:
+        return OUTCOME_BAD_REQUEST;
+    case DUBBO_RES_T_BAD_RESPONSE:
+        return OUTCOME_BAD_RESPONSE;
+    case DUBBO_RES_T_SERVICE_NOT_FOUND:
+        return OUTCOME_SERVICE_NOT_FOUND;
+    case DUBBO_RES_T_SERVICE_ERROR:
+        return OUTCOME_SERVICE_ERROR;
+    case DUBBO_RES_T_SERVER_ERROR:
+        return OUTCOME_SERVER_ERROR;
+    case DUBBO_RES_T_CLIENT_ERROR:
+        return OUTCOME_CLIENT_ERROR;
+    default:
+        return OUTCOME_STATUS_OTHER;
+    }
+}
 
-    if (!sa_resolve(cli->args->host, &cli->addr))
+// 按异常类名归类: 取错误信息第一个 ':' 或换行之前的部分, 如 "java.lang.IllegalStateException: boom"
+static void bench_record_error(struct dubbo_bench *bench, const struct dubbo_res_view *view, enum bench_outcome outcome)
+{
+    const char *msg = view->data;
+    size_t len = view->data_sz;
+    if (msg == NULL || len == 0)
+    {
+        msg = outcome_names[outcome];
+        len = strlen(msg);
+    }
+    size_t n = 0;
+    while (n < len && msg[n] != ':' && msg[n] != '\n' && msg[n] != '\r')
     {
-        PANIC("%s DNS解析失败", cli->args->host);
+        n++;
     }
+    topk_add(bench->errors, msg, n, 1);
+}
 
-    cli->addr.v4.sin_port = htons(atoi(cli->args->port));
-    return cli;
+// 解码失败, 连接随后重连
+static void bench_decode_error(struct dubbo_bench *bench)
+{
+    if (bench->measuring)
+    {
+        bench->stats.outcome_n[OUTCOME_DECODE_ERROR]++;
+    }
 }
 
-static bool cli_connected(struct dubbo_client *cli)
+static void cli_ready_push(struct dubbo_client *cli)
 {
-    cli->connected = true;
-    cli_clear_timer(cli);
-    if (AE_ERR == aeCreateFileEvent(cli->el, cli->fd, AE_READABLE, cli_on_read, cli))
+    struct bench_target *tgt = cli->target;
+    if (cli->ready)
     {
-        return false;
+        return;
     }
-    cli_pipe_send(cli);
-    return true;
+    cli->ready = true;
+    cli->ready_next = NULL;
+    cli->ready_prev = tgt->ready_tail;
+    if (tgt->ready_tail)
+    {
+        tgt->ready_tail->ready_next = cli;
+    }
+    else
+    {
+        tgt->ready_head = cli;
+    }
+    tgt->ready_tail = cli;
+    cli->bench->lb.nodes[tgt->idx].avail = true;
 }
 
-int cli_connect_timeout(struct aeEventLoop *el, long long id, void *ud)
+static void cli_ready_remove(struct dubbo_client *cli)
 {
-    struct dubbo_client *cli = (struct dubbo_client *)ud;
-    LOG_ERROR("连接超时");
-    cli_reconnect(cli);
-    return AE_NOMORE;
+    struct bench_target *tgt = cli->target;
+    if (!cli->ready)
+    {
+        return;
+    }
+    cli->ready = false;
+    if (cli->ready_prev)
+    {
+        cli->ready_prev->ready_next = cli->ready_next;
+    }
+    else
+    {
+        tgt->ready_head = cli->ready_next;
+    }
+    if (cli->ready_next)
+    {
+        cli->ready_next->ready_prev = cli->ready_prev;
+    }
+    else
+    {
+        tgt->ready_tail = cli->ready_prev;
+    }
+    cli->ready_prev = NULL;
+    cli->ready_next = NULL;
+    cli->bench->lb.nodes[tgt->idx].avail = tgt->ready_head != NULL;
 }
 
-bool cli_connect(struct dubbo_client *cli)
+// 占用连接的一个 pipeline 与全局配额
+static void cli_take_slot(struct dubbo_client *cli)
 {
-    int fd = socket_create();
-    if (fd < 0)
+    struct dubbo_bench *bench = cli->bench;
+    cli->pipe_left--;
+    bench->send_left--;
+    bench->conc_left--;
+    bench->lb.nodes[cli->target->idx].inflight++;
+    // 连接间轮换, pipeline 占满则移出
+    cli_ready_remove(cli);
+    if (cli->pipe_left > 0)
     {
-        return false;
+        cli_ready_push(cli);
     }
-    cli->fd = fd;
+}
 
-    int status = socket_connect(fd, &cli->addr, sizeof(cli->addr.s));
-    if (status == 0)
+// 请求完成 (响应或超时) 释放 pipeline
+static void cli_release_slot(struct dubbo_client *cli)
+{
+    struct dubbo_bench *bench = cli->bench;
+    cli->pipe_left++;
+    bench->conc_left++;
+    bench->req_left--;
+    bench->lb.nodes[cli->target->idx].inflight--;
+    if (cli->conn.connected)
     {
-        if (!cli_connected(cli))
-        {
-            goto close;
-        }
+        cli_ready_push(cli);
     }
-    else
+}
+
+static void cli_reset(struct dubbo_client *cli)
+{
+    struct dubbo_bench *bench = cli->bench;
+    if (cli->conn.connected)
     {
-        if (errno == EINPROGRESS)
-        {
-            // 这里 貌似应该 read + write
-            if (AE_ERR == aeCreateFileEvent(cli->el, fd, AE_WRITABLE, cli_on_connect, cli))
-            {
-                goto close;
-            }
-            cli->timerid = aeCreateTimeEvent(cli->el, cli->timeout_ms, cli_connect_timeout, cli, NULL);
-            if (AE_ERR == cli->timerid)
-            {
-                cli->timerid = AE_NOMORE;
-                goto close;
-            }
-        }
-        else
-        {
-            goto close;
-        }
+        bench->connected_n--;
     }
-    return true;
 
-close:
-    close(fd);
-    return false;
+    // 连接上未完成的请求归还配额, 由其他连接或重连后补发
+    int pending_n = bench->pipe_n - cli->pipe_left;
+    bench->send_left += pending_n;
+    bench->conc_left += pending_n;
+    bench->lb.nodes[cli->target->idx].inflight -= pending_n;
+    cli_ready_remove(cli);
+
+    conn_close(&cli->conn);
+    if (cli->retry_timerid != AE_NOMORE)
+    {
+        aeDeleteTimeEvent(bench->el, cli->retry_timerid);
+        cli->retry_timerid = AE_NOMORE;
+    }
+    cli->flush_pending = false;
+    cli->pipe_left = bench->pipe_n;
+    cli->last_reqid = 0;
+    inflight_remove_ud(bench->inflight, cli);
+    bench_pub_inflight(bench);
 }
 
-static void cli_close(struct dubbo_client *cli)
+static struct dubbo_client *cli_create(struct dubbo_bench *bench, struct bench_target *target, int id)
 {
-    aeDeleteFileEvent(cli->el, cli->fd, AE_READABLE | AE_WRITABLE);
-    close(cli->fd);
+    struct dubbo_client *cli = calloc(1, sizeof(*cli));
+    assert(cli);
+    cli->bench = bench;
+    cli->target = target;
+    cli->id = id;
+    conn_init(&cli->conn, bench->el, &cli_conn_ops, cli, CLI_INIT_BUF_SZ);
+    cli->conn.io = &bench->io;
+    cli->retry_timerid = AE_NOMORE;
+    cli->pipe_left = bench->pipe_n;
     cli_reset(cli);
+    return cli;
 }
 
 static void cli_release(struct dubbo_client *cli)
 {
-    buf_release(cli->rcv_buf);
-    buf_release(cli->snd_buf);
+    conn_destroy(&cli->conn);
     free(cli);
 }
 
-void exit_handler()
+// 按线程均分: 前 n % parts 份各多分一个
+static int bench_share(int n, int parts, int idx)
 {
-    if (g_cli && g_cli->run)
-    {
-        cli_end(g_cli);
-    }
+    return n / parts + (idx < n % parts ? 1 : 0);
 }
 
-void sig_handler(int dummy)
+static int bench_share_offset(int n, int parts, int idx)
 {
-    if (g_cli && g_cli->run)
-    {
-        cli_end(g_cli);
-        exit(0);
-    }
+    return idx * (n / parts) + (idx < n % parts ? idx : n % parts);
 }
 
-static bool cli_start(struct dubbo_client *cli)
+static struct dubbo_bench *bench_create(struct dubbo_args *args, struct dubbo_async_args *async_args, const struct bench_workload *wl,
+                                        const union sockaddr_all *addrs, int id, int thread_n)
 {
-    if (cli->run)
+    struct dubbo_bench *bench = calloc(1, sizeof(*bench));
+    assert(bench);
+    bench->id = id;
+    bench->thread_n = thread_n;
+    bench->args = args;
+    bench->wl = wl;
+    bench->rng = 0x2545F4914F6CDD1DULL * (id + 1);
+    bench->verbos = async_args->verbos;
+
+    // fd 为进程内全局编号, setsize 按总连接数而非本线程连接数计算
+    int conn_total = async_args->conn_n * args->target_n;
+    bench->el = aeCreateEventLoop(conn_total + 1024);
+    assert(bench->el);
+    bench->stop_timerid = AE_NOMORE;
+
+    // 每个线程独占一段 reqid, 互不冲突
+    int64_t reqid_span = INT64_MAX / thread_n;
+    bench->reqid_begin = reqid_span * id + 1;
+    bench->reqid_end = reqid_span * (id + 1);
+
+    bench->req_n = async_args->req_n > 0 ? bench_share(async_args->req_n, thread_n, id) : BENCH_REQ_UNLIMITED;
+    bench->req_left = bench->req_n;
+    bench->send_left = bench->req_n;
+
+    bench->pipe_n = async_args->pipe_n;
+    if (bench->pipe_n > bench->req_n)
     {
-        return false;
+        bench->pipe_n = bench->req_n;
     }
 
-    atexit(exit_handler);
-    signal(SIGINT, sig_handler);
-    signal(SIGTERM, sig_handler);
-    gettimeofday(&cli->start, NULL);
+    if (async_args->report_interval_ms > 0)
+    {
+        pthread_mutex_init(&bench->ival_lock, NULL);
+        bench->ival.lat = hist_create();
+        bench->ival_spare = hist_create();
+    }
 
-    g_cli = cli;
-    cli->run = true;
+    bench->warmup_ms = async_args->warmup_ms;
+    bench->duration_ms = async_args->duration_ms;
+    bench->window_timerid = AE_NOMORE;
 
-    return cli_connect(cli);
-}
+    bench->run = false;
+    bench_stats_init(&bench->stats);
+    bench->errors = topk_create(BENCH_ERROR_TOPK);
+    bench->mstats = calloc(wl->method_n, sizeof(*bench->mstats));
+    assert(bench->mstats);
+    for (int i = 0; i < wl->method_n; i++)
+    {
+        bench_stats_init(&bench->mstats[i]);
+    }
 
-static void cli_end(struct dubbo_client *cli)
-{
-    if (cli->run)
+    if (wl->data)
+    {
+        bench->cursor = dataset_cursor_create(wl->data, id, thread_n, bench->rng);
+        bench->data_done = !dataset_next(bench->cursor, &bench->row, &bench->row_len);
+    }
+    if (wl->templated)
     {
-        cli_close(cli);
-        cli_clear_timer(cli);
+        bench->args_buf = buf_create(CLI_INIT_BUF_SZ);
+        argtpl_ctx_init(&bench->tpl_ctx, async_args->seed, id, thread_n);
+    }
 
-        gettimeofday(&cli->end, NULL);
-        g_cli = NULL;
-        cli->run = false;
-        aeStop(cli->el);
+    if (wl->corpus)
+    {
+        uint64_t frame_n = corpus_frame_n(wl->corpus);
+        bench->corpus_begin = frame_n * id / thread_n;
+        bench->corpus_end = frame_n * (id + 1) / thread_n;
+        if (bench->corpus_begin == bench->corpus_end)
+        {
+            // 帧数少于线程数, 共用全部语料
+            bench->corpus_begin = 0;
+            bench->corpus_end = frame_n;
+        }
+        bench->corpus_pos = bench->corpus_begin;
+        bench->corpus_wrap = async_args->dataset_wrap;
+    }
 
-        double elapsed_sec = ((double)cli->end.tv_sec + 1.0e-6 * cli->end.tv_usec) -
-                             ((double)cli->start.tv_sec + 1.0e-6 * cli->start.tv_usec);
-        int reqs = cli->req_n - cli->req_left;
-        double qps = elapsed_sec < 0.001 ? 0 : reqs / elapsed_sec;
-        fprintf(stderr, "\x1B[1;32m[SUMMARY]\x1B[0m COST %.2fs, REQ %d, SUCC %d, FAIL %d, QPS %.f\n", elapsed_sec, reqs, cli->ok_n, cli->ko_n, qps);
+    bench->rate_timerid = AE_NOMORE;
+    if (async_args->rate > 0)
+    {
+        bench->rate = async_args->rate / thread_n;
+        bench->rate_interval_us = 1000000.0 / bench->rate;
+    }
 
-        cli_release(cli);
+    bench->hb_timerid = AE_NOMORE;
+    if (async_args->heartbeat_ms > 0)
+    {
+        struct dubbo_req *hb = dubbo_heartbeat_create();
+        bench->hb_frame = dubbo_encode(hb);
+        dubbo_req_release(hb);
+        assert(bench->hb_frame);
+        bench->hb_us = (uint64_t)async_args->heartbeat_ms * 1000;
     }
-}
 
-static void cli_reconnect(struct dubbo_client *cli)
-{
-    LOG_INFO("重新连接...");
-    cli_close(cli);
-    if (!cli_connect(cli))
+    bench->timeout_ms = args->timeout.tv_sec * 1000;
+    bench->req_timeout_us = (async_args->req_timeout_ms > 0 ? async_args->req_timeout_ms : bench->timeout_ms) * 1000;
+    bench->expire_timerid = AE_NOMORE;
+
+    bench->target_n = args->target_n;
+    bench->targets = calloc(bench->target_n, sizeof(*bench->targets));
+    assert(bench->targets);
+    lb_init(&bench->lb, async_args->balance, bench->target_n, 0x9E3779B97F4A7C15ULL * (id + 1));
+    for (int i = 0; i < bench->target_n; i++)
     {
-        LOG_ERROR("重连失败");
+        bench->targets[i].idx = i;
+        bench->targets[i].addr = addrs[i];
+        bench_stats_init(&bench->targets[i].stats);
+        bench->lb.nodes[i].weight = args->targets[i].weight;
     }
-}
 
-static bool cli_write(struct dubbo_client *cli)
-{
-    struct buffer *buf = cli->snd_buf;
-    if (!buf_readable(buf))
+    // 全局连接编号按 provider 交错分配, 每个线程都连接到各个 provider
+    bench->cli_n = bench_share(conn_total, thread_n, id);
+    bench->inflight = inflight_create(bench->cli_n * bench->pipe_n);
+    int cli_id = bench_share_offset(conn_total, thread_n, id);
+    bench->clis = calloc(bench->cli_n, sizeof(*bench->clis));
+    assert(bench->clis);
+    bench->flush_cap = bench->cli_n;
+    bench->flush_q = calloc(bench->flush_cap, sizeof(*bench->flush_q));
+    assert(bench->flush_q);
+    for (int i = 0; i < bench->cli_n; i++)
     {
-        aeDeleteFileEvent(cli->el, cli->fd, AE_WRITABLE);
-        return true;
+        bench->clis[i] = cli_create(bench, &bench->targets[(cli_id + i) % bench->target_n], cli_id + i);
     }
 
-    int nwritten = 0;
-    while (buf_readable(buf))
+    if (wl->replay)
     {
-        nwritten = write(cli->fd, buf_peek(buf), buf_readable(buf));
-        if (nwritten <= 0)
+        // 原始连接 k 对应全局连接 k % conn_total, 本线程只回放落在自己连接上的帧
+        uint64_t frame_n = replay_frame_n(wl->replay);
+        uint64_t cap = 0;
+        for (uint64_t i = 0; i < frame_n; i++)
         {
-            if (errno == EINTR)
+            const struct replay_frame *f = replay_frame(wl->replay, i);
+            int k = (int)(f->conn % conn_total) - cli_id;
+            if (k < 0 || k >= bench->cli_n)
             {
                 continue;
             }
-            break;
-        }
-        buf_retrieve(buf, nwritten);
-    }
-
-    if (nwritten <= 0)
-    {
-        if (errno == EAGAIN)
-        {
-            if (AE_ERR == aeCreateFileEvent(cli->el, cli->fd, AE_WRITABLE, cli_on_write, cli))
+            if (bench->replay_n == cap)
             {
-                LOG_ERROR("Dubbo 请求失败: 创建可写事件失败");
-                return false;
+                cap = cap ? cap * 2 : 1024;
+                bench->replay_q = realloc(bench->replay_q, cap * sizeof(*bench->replay_q));
+                assert(bench->replay_q);
             }
-            return true;
-        }
-        else
-        {
-            LOG_ERROR("Dubbo 发送数据失败: %s", strerror(errno));
-            return false;
+            bench->replay_q[bench->replay_n].frame = f;
+            bench->replay_q[bench->replay_n].cli = bench->clis[k];
+            bench->replay_n++;
         }
+        bench->replay_speed = async_args->replay_speed;
+        bench->replay_lag = hist_create();
+        bench->data_done = bench->replay_n == 0;
     }
 
-    if (!buf_readable(buf))
+    // 闭环模式的总并发同单个 provider 时 (pipe_n * conn_n), 多个 provider 时由均衡策略分配
+    if (bench->rate > 0 || wl->replay)
     {
-        aeDeleteFileEvent(cli->el, cli->fd, AE_WRITABLE);
+        bench->conc_left = (int64_t)bench->pipe_n * bench->cli_n;
     }
-    return true;
-}
-
-static void cli_send_req(struct dubbo_client *cli)
-{
-    struct buffer *buf = cli_encode_req(cli);
-    if (buf == NULL)
+    else
     {
-        PANIC("Dubbo 请求失败: 编码失败");
-        return;
+        bench->conc_left = ((int64_t)bench->pipe_n * bench->cli_n + bench->target_n - 1) / bench->target_n;
     }
+    bench->conc_cap = bench->conc_left;
 
-    buf_append(cli->snd_buf, buf_peek(buf), buf_readable(buf));
-    buf_release(buf);
-    if (!cli_write(cli))
+    bench->profile = async_args->profile;
+    bench->profile_timerid = AE_NOMORE;
+    if (bench->profile)
     {
-        cli_reconnect(cli);
+        bench_profile_apply(bench);
     }
+    return bench;
 }
 
-static void cli_pipe_send(struct dubbo_client *cli)
+static void bench_release(struct dubbo_bench *bench)
 {
-    while (cli->pipe_left--)
+    for (int i = 0; i < bench->cli_n; i++)
     {
-        cli_send_req(cli);
+        cli_release(bench->clis[i]);
     }
-    cli->pipe_left++;
-}
-
-static void cli_on_connect(struct aeEventLoop *el, int fd, void *ud, int mask)
-{
-    struct dubbo_client *cli = (struct dubbo_client *)ud;
-    // 注意: ae 将 err 与 hup 转换成 write 事件
-    if ((mask & AE_WRITABLE) /* && !(mask & AE_READABLE)*/)
+    free(bench->clis);
+    for (int i = 0; i < bench->target_n; i++)
     {
-        aeDeleteFileEvent(el, fd, AE_WRITABLE /* | AE_READABLE*/);
-        // 所以, 可能出错 !!!
-        cli_connected(cli);
+        bench_stats_destroy(&bench->targets[i].stats);
     }
-    else
+    free(bench->targets);
+    lb_destroy(&bench->lb);
+    for (int i = 0; i < bench->wl->method_n; i++)
+    {
+        bench_stats_destroy(&bench->mstats[i]);
+    }
+    free(bench->mstats);
+    if (bench->cursor)
+    {
+        dataset_cursor_release(bench->cursor);
+    }
+    if (bench->args_buf)
+    {
+        buf_release(bench->args_buf);
+    }
+    free(bench->flush_q);
+    free(bench->replay_q);
+    if (bench->hb_frame)
+    {
+        buf_release(bench->hb_frame);
+    }
+    if (bench->replay_lag)
+    {
+        hist_release(bench->replay_lag);
+    }
+    if (bench->capture)
+    {
+        capture_buf_release(bench->capture);
+    }
+    inflight_release(bench->inflight);
+    bench_stats_destroy(&bench->stats);
+    topk_release(bench->errors);
+    if (bench->ival.lat)
     {
-        LOG_ERROR("连接失败: %s", strerror(errno));
-        cli_reconnect(cli);
+        pthread_mutex_destroy(&bench->ival_lock);
+        hist_release(bench->ival.lat);
+        hist_release(bench->ival_spare);
     }
+    aeDeleteEventLoop(bench->el);
+    free(bench);
 }
 
-static void cli_on_write(struct aeEventLoop *el, int fd, void *ud, int mask)
+static bool cli_connect(struct dubbo_client *cli)
 {
-    UNUSED(el);
-    UNUSED(fd);
-    UNUSED(mask);
+    return conn_connect(&cli->conn, &cli->target->addr, cli->bench->timeout_ms);
+}
 
-    struct dubbo_client *cli = (struct dubbo_client *)ud;
-    assert(cli->connected);
+static void cli_close(struct dubbo_client *cli)
+{
+    cli_reset(cli);
+}
 
-    if (!cli_write(cli))
+static int bench_check_stop(struct aeEventLoop *el, long long id, void *ud)
+{
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    if (stop_signal_raised())
     {
-        cli_reconnect(cli);
+        bench->stop_timerid = AE_NOMORE;
+        bench_end(bench);
+        return AE_NOMORE;
     }
+    return BENCH_CHECK_STOP_MS;
 }
 
-static void cli_on_read(struct aeEventLoop *el, int fd, void *ud, int mask)
+static int bench_on_rate_tick(struct aeEventLoop *el, long long id, void *ud)
 {
-    UNUSED(el);
-    UNUSED(mask);
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    bench_fill(bench);
+    return BENCH_RATE_TICK_MS;
+}
 
-    struct dubbo_client *cli = (struct dubbo_client *)ud;
-    assert(cli->connected);
+// 按负载曲线当前时刻的目标值调整发送间隔或并发额度, 统计窗口开启前取起点的值
+static void bench_profile_apply(struct dubbo_bench *bench)
+{
+    uint64_t now = now_us();
+    long t_ms = bench->profile_t0 ? (long)((now - bench->profile_t0) / 1000) : 0;
+    int phase = 0;
+    double val = profile_value(bench->profile, t_ms, &phase);
+    __atomic_store_n(&bench->phase, phase, __ATOMIC_RELAXED);
 
-    for (;;)
+    if (bench->profile->kind == PROFILE_RATE)
     {
-        int errno_ = 0;
-        ssize_t recv_n = buf_readFd(cli->rcv_buf, fd, &errno_);
-        if (recv_n < 0)
+        double rate = val / bench->thread_n;
+        if (rate <= 0)
         {
-            if (errno_ == EINTR)
-            {
-                continue;
-            }
-            else if (errno_ == EAGAIN)
-            {
-            }
-            else
-            {
-                LOG_ERROR("从 Dubbo 服务端读取数据: %s", strerror(errno));
-                cli_reconnect(cli);
-                return;
-            }
+            bench->rate_interval_us = 0;
+            return;
         }
-        else if (recv_n == 0)
+        if (bench->rate_interval_us == 0 && bench->rate_t0 && bench->rate_next_us < now - bench->rate_t0)
         {
-            LOG_ERROR("Dubbo 服务端断开连接");
-            cli_reconnect(cli);
-            return;
+            // 暂停期间没有请求到期, 恢复时从当前时刻排起
+            bench->rate_next_us = now - bench->rate_t0;
         }
-        break;
-    }
-
-    if (!is_dubbo_pkt(cli->rcv_buf))
-    {
-        LOG_ERROR("接收到非 dubbo 数据包");
-        cli_reconnect(cli);
-        return;
+        bench->rate_interval_us = 1000000.0 / rate;
     }
-
-    int remaining = 0;
-    if (!is_completed_dubbo_pkt(cli->rcv_buf, &remaining))
+    else
     {
-        LOG_ERROR("接收到异常 dubbo 数据包");
-        cli_reconnect(cli);
-        return;
-    }
-    if (remaining) {
-        return;
+        // 闭环并发额度可能暂时为负, 在途请求完成后才继续发送
+        int64_t cap = (int64_t)(val * bench->cli_n / bench->target_n + 0.5);
+        bench->conc_left += cap - bench->conc_cap;
+        bench->conc_cap = cap;
     }
+}
 
-    cli->pipe_left++;
-    cli->req_left--;
+static int bench_on_profile_tick(struct aeEventLoop *el, long long id, void *ud)
+{
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    bench_profile_apply(bench);
+    bench_fill(bench);
+    return BENCH_PROFILE_TICK_MS;
+}
 
-    if (((cli->req_n - cli->req_left) % 1000) == 0)
-    {
-        fprintf(stderr, "已发送请求 %d\n", cli->req_n - cli->req_left);
-    }
+static void cli_send_heartbeat(struct dubbo_client *cli)
+{
+    struct dubbo_bench *bench = cli->bench;
+    const struct buffer *frame = bench->hb_frame;
+    buf_append(cli->conn.snd_buf, buf_peek(frame), buf_readable(frame));
+    dubbo_frame_set_reqid(buf_beginWrite(cli->conn.snd_buf) - buf_readable(frame), dubbo_next_reqid());
+    bench->hb_sent++;
+    cli_flush_later(cli);
+}
 
-    bool ok = cli_decode_resp(cli);
-    
-    if (cli->req_left <= 0)
-    {
-        cli_end(cli);
-    }
-    else
+// 同 Dubbo HeartbeatTimerTask 与 ReconnectTimerTask: 空闲连接发送心跳, 长时间收不到数据视为假死重连
+static int bench_on_heartbeat(struct aeEventLoop *el, long long id, void *ud)
+{
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    uint64_t now = now_us();
+    for (int i = 0; i < bench->cli_n; i++)
     {
-        if (ok)
+        struct dubbo_client *cli = bench->clis[i];
+        if (!cli->conn.connected)
         {
-            cli_pipe_send(cli);
+            continue;
         }
-        else
+        if (now - cli->conn.last_read_us > BENCH_HEARTBEAT_TIMEOUT_N * bench->hb_us)
         {
+            LOG_ERROR("连接 %d 超过 %.1fs 没有收到数据", cli->id, BENCH_HEARTBEAT_TIMEOUT_N * bench->hb_us / 1e6);
             cli_reconnect(cli);
+            continue;
+        }
+        if (now - cli->conn.last_read_us >= bench->hb_us || now - cli->conn.last_write_us >= bench->hb_us)
+        {
+            cli_send_heartbeat(cli);
         }
     }
+    long tick_ms = (long)(bench->hb_us / 1000 / BENCH_HEARTBEAT_CHECK_N);
+    return tick_ms > 0 ? tick_ms : 1;
 }
 
-static bool cli_decode_resp(struct dubbo_client *cli)
+static void bench_on_req_timeout(struct inflight_entry *entry, void *ud)
 {
-    struct buffer *buf = cli->rcv_buf;
-    struct dubbo_res *res = dubbo_decode(buf);
-    if (res == NULL)
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    struct dubbo_client *cli = (struct dubbo_client *)entry->ud;
+    if (bench->verbos)
     {
-        return false;
+        printf("<res seq=%" PRId64 "> [\x1B[1;31mTIMEOUT\x1B[0m]\n", entry->reqid);
+    }
+    if (bench->measuring)
+    {
+        bench_stats_timeout(&bench->stats);
+        bench_stats_timeout(&cli->target->stats);
+        bench_stats_timeout(&bench->mstats[entry->tag]);
+    }
+    cli_release_slot(cli);
+    bench_ival_record(bench, true, false, 0);
+}
+
+static int bench_on_expire(struct aeEventLoop *el, long long id, void *ud)
+{
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    if (inflight_expire(bench->inflight, now_us(), bench_on_req_timeout, bench) == 0)
+    {
+        return BENCH_EXPIRE_TICK_MS;
+    }
+
+    if (bench->req_left <= 0)
+    {
+        bench->expire_timerid = AE_NOMORE;
+        bench_end(bench);
+        return AE_NOMORE;
+    }
+    bench_fill(bench);
+    return BENCH_EXPIRE_TICK_MS;
+}
+
+static void bench_open_window(struct dubbo_bench *bench)
+{
+    gettimeofday(&bench->start, NULL);
+    bench->profile_t0 = now_us();
+    bench->io_base = bench->io;
+    __atomic_store_n(&bench->measuring, true, __ATOMIC_RELAXED);
+}
+
+// 预热结束开启统计窗口, 窗口到期结束压测; 同一个定时器先后用于两个阶段
+static int bench_on_window(struct aeEventLoop *el, long long id, void *ud)
+{
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    if (!bench->measuring)
+    {
+        bench_open_window(bench);
+        if (bench->duration_ms > 0)
+        {
+            return bench->duration_ms;
+        }
+        bench->window_timerid = AE_NOMORE;
+        return AE_NOMORE;
+    }
+    bench->window_timerid = AE_NOMORE;
+    bench_end(bench);
+    return AE_NOMORE;
+}
+
+// 所有连接首次建连都有结果时开始预热计时, 连不上的 provider 不阻塞统计窗口, 之后的重连不影响统计窗口
+static void bench_on_all_settled(struct dubbo_bench *bench)
+{
+    if (bench->wl->replay && bench->replay_t0 == 0)
+    {
+        // 原始时间表从全部连接首次建连有结果时开始, 避免首批帧等待建连
+        bench->replay_t0 = now_us();
+    }
+    if (bench->measuring || bench->window_timerid != AE_NOMORE)
+    {
+        return;
+    }
+
+    long after_ms = bench->warmup_ms;
+    if (after_ms == 0)
+    {
+        bench_open_window(bench);
+        after_ms = bench->duration_ms;
+    }
+    if (after_ms > 0)
+    {
+        bench->window_timerid = aeCreateTimeEvent(bench->el, after_ms, bench_on_window, bench, NULL);
+        if (AE_ERR == bench->window_timerid)
+        {
+            LOG_ERROR("创建统计窗口定时器失败");
+            bench->window_timerid = AE_NOMORE;
+            bench_end(bench);
+        }
+    }
+}
+
+static bool bench_start(struct dubbo_bench *bench)
+{
+    if (bench->run)
+    {
+        return false;
+    }
+
+    bench->run = true;
+    if (bench->warmup_ms == 0 && bench->duration_ms == 0)
+    {
+        // 只按请求数结束时不等待连接建立, 所有请求均计入统计
+        bench_open_window(bench);
+    }
+
+    bench->stop_timerid = aeCreateTimeEvent(bench->el, BENCH_CHECK_STOP_MS, bench_check_stop, bench, NULL);
+    if (AE_ERR == bench->stop_timerid)
+    {
+        bench->stop_timerid = AE_NOMORE;
+        return false;
+    }
+
+    bench->expire_timerid = aeCreateTimeEvent(bench->el, BENCH_EXPIRE_TICK_MS, bench_on_expire, bench, NULL);
+    if (AE_ERR == bench->expire_timerid)
+    {
+        bench->expire_timerid = AE_NOMORE;
+        return false;
+    }
+
+    if (bench->rate > 0 || bench->wl->replay)
+    {
+        bench->rate_timerid = aeCreateTimeEvent(bench->el, BENCH_RATE_TICK_MS, bench_on_rate_tick, bench, NULL);
+        if (AE_ERR == bench->rate_timerid)
+        {
+            bench->rate_timerid = AE_NOMORE;
+            return false;
+        }
+    }
+
+    if (bench->hb_frame)
+    {
+        long tick_ms = (long)(bench->hb_us / 1000 / BENCH_HEARTBEAT_CHECK_N);
+        bench->hb_timerid = aeCreateTimeEvent(bench->el, tick_ms > 0 ? tick_ms : 1, bench_on_heartbeat, bench, NULL);
+        if (AE_ERR == bench->hb_timerid)
+        {
+            bench->hb_timerid = AE_NOMORE;
+            return false;
+        }
+    }
+
+    if (bench->profile)
+    {
+        bench->profile_timerid = aeCreateTimeEvent(bench->el, BENCH_PROFILE_TICK_MS, bench_on_profile_tick, bench, NULL);
+        if (AE_ERR == bench->profile_timerid)
+        {
+            bench->profile_timerid = AE_NOMORE;
+            return false;
+        }
+    }
+
+    int connected_n = 0;
+    for (int i = 0; i < bench->cli_n; i++)
+    {
+        if (cli_connect(bench->clis[i]))
+        {
+            connected_n++;
+        }
+        else
+        {
+            LOG_ERROR("连接 %d 创建失败: %s", bench->clis[i]->id, strerror(errno));
+            cli_settle(bench->clis[i]);
+            cli_reconnect_later(bench->clis[i]);
+        }
+    }
+    return connected_n > 0;
+}
+
+static void bench_end(struct dubbo_bench *bench)
+{
+    if (bench->run)
+    {
+        for (int i = 0; i < bench->cli_n; i++)
+        {
+            cli_close(bench->clis[i]);
+        }
+        if (bench->stop_timerid != AE_NOMORE)
+        {
+            aeDeleteTimeEvent(bench->el, bench->stop_timerid);
+            bench->stop_timerid = AE_NOMORE;
+        }
+        if (bench->rate_timerid != AE_NOMORE)
+        {
+            aeDeleteTimeEvent(bench->el, bench->rate_timerid);
+            bench->rate_timerid = AE_NOMORE;
+        }
+        if (bench->expire_timerid != AE_NOMORE)
+        {
+            aeDeleteTimeEvent(bench->el, bench->expire_timerid);
+            bench->expire_timerid = AE_NOMORE;
+        }
+        if (bench->window_timerid != AE_NOMORE)
+        {
+            aeDeleteTimeEvent(bench->el, bench->window_timerid);
+            bench->window_timerid = AE_NOMORE;
+        }
+        if (bench->profile_timerid != AE_NOMORE)
+        {
+            aeDeleteTimeEvent(bench->el, bench->profile_timerid);
+            bench->profile_timerid = AE_NOMORE;
+        }
+        if (bench->hb_timerid != AE_NOMORE)
+        {
+            aeDeleteTimeEvent(bench->el, bench->hb_timerid);
+            bench->hb_timerid = AE_NOMORE;
+        }
+
+        gettimeofday(&bench->end, NULL);
+        bench->stats.write_n = bench->io.write_n;
+        if (bench->measuring)
+        {
+            bench->stats.bytes_in = bench->io.bytes_in - bench->io_base.bytes_in;
+            bench->stats.bytes_out = bench->io.bytes_out - bench->io_base.bytes_out;
+        }
+        bench->run = false;
+        aeStop(bench->el);
+    }
+}
+
+// 写合并: 事件循环一轮中的所有请求追加到 snd_buf, 进入 poll 前每个连接只 write 一次
+static void bench_flush(struct aeEventLoop *el)
+{
+    struct dubbo_bench *bench = t_bench;
+    // 重连可能再次入队, flush_n 在循环中可能增长
+    for (int i = 0; i < bench->flush_n; i++)
+    {
+        struct dubbo_client *cli = bench->flush_q[i];
+        if (!cli->flush_pending)
+        {
+            continue;
+        }
+        cli->flush_pending = false;
+        if (!conn_write(&cli->conn))
+        {
+            cli_on_error(&cli->conn, CONN_ERR_WRITE, errno);
+        }
+    }
+    bench->flush_n = 0;
+}
+
+static void *bench_thread(void *ud)
+{
+    struct dubbo_bench *bench = (struct dubbo_bench *)ud;
+    t_bench = bench;
+    dubbo_reqid_range(bench->reqid_begin, bench->reqid_end);
+    aeSetBeforeSleepProc(bench->el, bench_flush);
+    if (bench_start(bench))
+    {
+        aeMain(bench->el);
+    }
+    else
+    {
+        bench_end(bench);
+    }
+    __atomic_store_n(&bench->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void bench_stats_merge(struct bench_stats *dst, const struct bench_stats *src)
+{
+    dst->ok_n += src->ok_n;
+    dst->ko_n += src->ko_n;
+    dst->timeout_n += src->timeout_n;
+    dst->unmatched_n += src->unmatched_n;
+    dst->reorder_n += src->reorder_n;
+    dst->done_n += src->done_n;
+    dst->send_n += src->send_n;
+    dst->write_n += src->write_n;
+    dst->bytes_in += src->bytes_in;
+    dst->bytes_out += src->bytes_out;
+    for (int i = 0; i < OUTCOME_N; i++)
+    {
+        dst->outcome_n[i] += src->outcome_n[i];
+    }
+    hist_merge(dst->lat, src->lat);
+    hist_merge(dst->lat_ko, src->lat_ko);
+}
+
+static void cli_reconnect(struct dubbo_client *cli)
+{
+    struct dubbo_bench *bench = cli->bench;
+    if (bench->measuring)
+    {
+        bench->stats.outcome_n[OUTCOME_CONN_ERROR] += bench->pipe_n - cli->pipe_left;
+    }
+    cli_close(cli);
+    cli_reconnect_later(cli);
+}
+
+static int cli_on_retry(struct aeEventLoop *el, long long id, void *ud)
+{
+    UNUSED(el);
+    UNUSED(id);
+    struct dubbo_client *cli = (struct dubbo_client *)ud;
+    cli->retry_timerid = AE_NOMORE;
+    LOG_INFO("连接 %d 重新连接...", cli->id);
+    if (!cli_connect(cli))
+    {
+        LOG_ERROR("连接 %d 重连失败: %s", cli->id, strerror(errno));
+        cli_reconnect_later(cli);
+    }
+    return AE_NOMORE;
+}
+
+// 断开后首次重连立即进行, 连续失败按指数退避, 避免 provider 不可达时空转重连
+static void cli_reconnect_later(struct dubbo_client *cli)
+{
+    long delay_ms = cli->backoff_ms;
+    cli->backoff_ms = delay_ms == 0 ? BENCH_RECONNECT_MIN_MS : delay_ms * 2;
+    if (cli->backoff_ms > BENCH_RECONNECT_MAX_MS)
+    {
+        cli->backoff_ms = BENCH_RECONNECT_MAX_MS;
+    }
+    cli->retry_timerid = aeCreateTimeEvent(cli->bench->el, delay_ms, cli_on_retry, cli, NULL);
+    if (AE_ERR == cli->retry_timerid)
+    {
+        cli->retry_timerid = AE_NOMORE;
+        LOG_ERROR("连接 %d 重连失败: 创建定时器失败", cli->id);
+    }
+}
+
+// 首次建连成功或失败都算有结果, 全部有结果后开始预热计时
+static void cli_settle(struct dubbo_client *cli)
+{
+    struct dubbo_bench *bench = cli->bench;
+    if (cli->settled)
+    {
+        return;
+    }
+    cli->settled = true;
+    if (++bench->settled_n == bench->cli_n)
+    {
+        bench_on_all_settled(bench);
+    }
+}
+
+static void cli_flush_later(struct dubbo_client *cli)
+{
+    struct dubbo_bench *bench = cli->bench;
+    if (cli->flush_pending)
+    {
+        return;
+    }
+    if (bench->flush_n == bench->flush_cap)
+    {
+        bench->flush_cap *= 2;
+        bench->flush_q = realloc(bench->flush_q, bench->flush_cap * sizeof(*bench->flush_q));
+        assert(bench->flush_q);
+    }
+    cli->flush_pending = true;
+    bench->flush_q[bench->flush_n++] = cli;
+}
+
+// 编码方法 m 的一个请求追加到发送缓冲
+static void cli_append_req(struct dubbo_client *cli, int m, int64_t reqid)
+{
+    struct dubbo_bench *bench = cli->bench;
+    const struct bench_workload *wl = bench->wl;
+    if (wl->tpls[m] == NULL)
+    {
+        // 复制预编码的请求帧, 只改写 reqid
+        const struct buffer *frame = wl->frames[m];
+        buf_append(cli->conn.snd_buf, buf_peek(frame), buf_readable(frame));
+        dubbo_frame_set_reqid(buf_beginWrite(cli->conn.snd_buf) - buf_readable(frame), reqid);
+    }
+    else
+    {
+        // 渲染参数 (引用数据集时用预取的一行), 直接编码到发送缓冲
+        buf_retrieveAll(bench->args_buf);
+        argtpl_render(wl->tpls[m], &bench->tpl_ctx, bench->row, bench->row_len, bench->args_buf);
+        buf_ensureWritable(bench->args_buf, 1);
+        *buf_beginWrite(bench->args_buf) = 0;
+        dubbo_req_tpl_encode(wl->req_tpls[m], reqid, buf_peek(bench->args_buf), buf_readable(bench->args_buf), cli->conn.snd_buf);
+        if (argtpl_uses_data(wl->tpls[m]))
+        {
+            bench->data_done = !dataset_next(bench->cursor, &bench->row, &bench->row_len);
+        }
+    }
+}
+
+static void cli_send_req(struct dubbo_client *cli, uint64_t start_us)
+{
+    struct dubbo_bench *bench = cli->bench;
+    int64_t reqid = dubbo_next_reqid();
+    if (bench->verbos)
+    {
+        printf("<req>[conn=%d][seq=%" PRId64 "]\n", cli->id, reqid);
+    }
+
+    const struct bench_workload *wl = bench->wl;
+    size_t frame_off = buf_readable(cli->conn.snd_buf);
+    int m;
+    if (wl->replay)
+    {
+        // 原样复制录制的请求帧, 只改写 reqid, 与其他线程及原始 reqid 都不冲突
+        const struct replay_frame *f = bench->replay_q[bench->replay_pos].frame;
+        buf_append(cli->conn.snd_buf, f->data, f->len);
+        dubbo_frame_set_reqid(buf_beginWrite(cli->conn.snd_buf) - f->len, reqid);
+        m = 0;
+        bench->data_done = ++bench->replay_pos == bench->replay_n;
+    }
+    else if (wl->corpus)
+    {
+        // 直接从映射复制请求帧, 只改写 reqid, 与参数复杂度无关
+        size_t len;
+        const char *frame = corpus_frame(wl->corpus, bench->corpus_pos, &len, &m);
+        buf_append(cli->conn.snd_buf, frame, len);
+        dubbo_frame_set_reqid(buf_beginWrite(cli->conn.snd_buf) - len, reqid);
+        if (++bench->corpus_pos == bench->corpus_end)
+        {
+            bench->corpus_pos = bench->corpus_begin;
+            bench->data_done = !bench->corpus_wrap;
+        }
+    }
+    else
+    {
+        // 多个方法时按权重抽样, O(1)
+        m = wl->mix ? alias_sample(wl->mix, &bench->rng) : 0;
+        cli_append_req(cli, m, reqid);
+    }
+    if (bench->capture)
+    {
+        capture_add(bench->capture, now_us(), cli->id, CAPTURE_SEND, reqid,
+                    buf_peek(cli->conn.snd_buf) + frame_off, buf_readable(cli->conn.snd_buf) - frame_off);
+    }
+
+    if (!inflight_put(bench->inflight, reqid, cli, m, start_us, now_us() + bench->req_timeout_us))
+    {
+        LOG_ERROR("重复的 reqid %" PRId64, reqid);
+    }
+    bench->stats.send_n++;
+    bench_pub_inflight(bench);
+    cli_flush_later(cli);
+}
+
+// 按均衡策略选取 provider, 再取其有空闲 pipeline 的连接
+static struct dubbo_client *bench_pick_cli(struct dubbo_bench *bench)
+{
+    int idx = lb_pick(&bench->lb, now_us());
+    if (idx == -1)
+    {
+        return NULL;
+    }
+    return bench->targets[idx].ready_head;
+}
+
+// 闭环: 并发额度有剩余就发送
+static void bench_pipe_send(struct dubbo_bench *bench)
+{
+    while (bench->conc_left > 0 && bench->send_left > 0 && !bench->data_done)
+    {
+        struct dubbo_client *cli = bench_pick_cli(bench);
+        if (cli == NULL)
+        {
+            break;
+        }
+        cli_take_slot(cli);
+        cli_send_req(cli, now_us());
+    }
+}
+
+// 开环定速: 按预期发送时间表发送已到期的请求, 与响应快慢无关
+// 所有连接 pipeline 已满时到期请求排队, 排队时间计入延迟 (coordinated omission 校正)
+static void bench_rate_send(struct dubbo_bench *bench)
+{
+    if (bench->rate_t0 == 0)
+    {
+        return;
+    }
+
+    uint64_t now = now_us();
+    while (bench->rate_interval_us > 0 && bench->send_left > 0 && !bench->data_done)
+    {
+        uint64_t intended_us = bench->rate_t0 + (uint64_t)bench->rate_next_us;
+        if (intended_us > now)
+        {
+            break;
+        }
+        struct dubbo_client *cli = bench_pick_cli(bench);
+        if (cli == NULL)
+        {
+            break;
+        }
+        bench->rate_next_us += bench->rate_interval_us;
+        cli_take_slot(cli);
+        cli_send_req(cli, intended_us);
+    }
+}
+
+// 流量回放: 按原始时间表 (除以倍速) 发送已到期的帧, 帧固定在映射的连接上
+// 与开环定速相同, 延迟从预期发送时间开始计算, 实际发送落后预期的时间另行统计
+static void bench_replay_send(struct dubbo_bench *bench)
+{
+    if (bench->replay_t0 == 0)
+    {
+        return;
+    }
+
+    uint64_t now = now_us();
+    while (bench->replay_pos < bench->replay_n && bench->send_left > 0)
+    {
+        const struct bench_replay_item *item = &bench->replay_q[bench->replay_pos];
+        uint64_t intended_us = bench->replay_t0 + (uint64_t)(item->frame->off_us / bench->replay_speed);
+        if (intended_us > now)
+        {
+            break;
+        }
+        struct dubbo_client *cli = item->cli;
+        if (!cli->conn.connected || cli->pipe_left <= 0)
+        {
+            break;
+        }
+        hist_record(bench->replay_lag, now_us() - intended_us);
+        cli_take_slot(cli);
+        cli_send_req(cli, intended_us);
+    }
+}
+
+static void bench_fill(struct dubbo_bench *bench)
+{
+    if (bench->wl->replay)
+    {
+        bench_replay_send(bench);
+    }
+    else if (bench->rate > 0)
+    {
+        bench_rate_send(bench);
+    }
+    else
+    {
+        bench_pipe_send(bench);
+    }
+
+    // 数据集或回放帧已读完, 未发送的配额作废, 已发送的请求全部完成后结束
+    if (bench->data_done && bench->send_left > 0)
+    {
+        bench->req_left -= bench->send_left;
+        bench->send_left = 0;
+        if (bench->req_left <= 0)
+        {
+            bench_end(bench);
+        }
+    }
+}
+
+static void cli_on_connect(struct conn *c)
+{
+    struct dubbo_client *cli = (struct dubbo_client *)c->ud;
+    struct dubbo_bench *bench = cli->bench;
+    if (bench->rate > 0 && bench->rate_t0 == 0)
+    {
+        // 首个连接建立后开始计时
+        bench->rate_t0 = now_us();
+    }
+    bench->connected_n++;
+    cli->backoff_ms = 0;
+    cli_settle(cli);
+    cli_ready_push(cli);
+    bench_fill(bench);
+}
+
+static bool cli_on_frame(struct conn *c, size_t len)
+{
+    struct dubbo_client *cli = (struct dubbo_client *)c->ud;
+    struct dubbo_bench *bench = cli->bench;
+    if (bench->capture)
+    {
+        const char *frame = buf_peek(c->rcv_buf);
+        capture_add(bench->capture, now_us(), cli->id, CAPTURE_RECV, dubbo_frame_get_reqid(frame), frame, len);
+    }
+    return cli_decode_resp(cli);
+}
+
+// 整批处理完后统一补发请求
+static void cli_on_frames(struct conn *c, int frame_n)
+{
+    UNUSED(frame_n);
+    struct dubbo_client *cli = (struct dubbo_client *)c->ud;
+    struct dubbo_bench *bench = cli->bench;
+    if (bench->req_left <= 0)
+    {
+        bench_end(bench);
+    }
+    else
+    {
+        bench_fill(bench);
+    }
+}
+
+static void cli_on_error(struct conn *c, enum conn_err err, int sys_errno)
+{
+    struct dubbo_client *cli = (struct dubbo_client *)c->ud;
+    if (sys_errno)
+    {
+        LOG_ERROR("连接 %d %s: %s", cli->id, conn_strerror(err), strerror(sys_errno));
+    }
+    else
+    {
+        LOG_ERROR("连接 %d %s", cli->id, conn_strerror(err));
+    }
+    if (err == CONN_ERR_PROTO)
+    {
+        bench_decode_error(cli->bench);
+    }
+    // 首次建连失败或超时同样算有结果, 不阻塞统计窗口
+    cli_settle(cli);
+    cli_reconnect(cli);
+}
+
+static void cli_print_resp(const struct dubbo_res *res)
+{
+    if (res->is_evt)
+    {
+        printf("<res seq=%" PRId64 "> [EVT]", res->reqid);
+    }
+    else if (res->data_sz)
+    {
+        // 返回 json, 不应该有 NULL 存在, 且非 NULL 结尾
+        char *json = malloc(res->data_sz + 1);
+        assert(json);
+        memcpy(json, res->data, res->data_sz);
+        json[res->data_sz] = '\0';
+
+        cJSON *resp = NULL;
+        if ((json[0] == '[' || json[0] == '{') && (resp = cJSON_Parse(json)))
+        {
+            if (res->ok)
+            {
+                printf("<res seq=%" PRId64 "> [\x1B[1;32mSUCC\x1B[0m] %s\n", res->reqid, cJSON_Print(resp));
+            }
+            else
+            {
+                printf("<res seq=%" PRId64 "> [\x1B[1;31mFAIL\x1B[0m] [\x1B[1;31m%s\x1B[0m] %s\n", res->reqid, res->desc, cJSON_Print(resp));
+            }
+            cJSON_Delete(resp);
+        }
+        else
+        {
+            if (res->ok)
+            {
+                printf("<res seq=%" PRId64 "> [\x1B[1;32mSUCC\x1B[0m] %s\n", res->reqid, json);
+            }
+            else
+            {
+                printf("<res seq=%" PRId64 "> [\x1B[1;31mFAIL\x1B[0m] %s\n", res->reqid, json);
+            }
+        }
+        free(json);
+    }
+    else if (res->data_sz == 0)
+    {
+        printf("<res seq=%" PRId64 "> [\x1B[1;32mSUCC\x1B[0m] NULL\n", res->reqid);
+    }
+}
+
+static bool cli_decode_resp(struct dubbo_client *cli)
+{
+    struct dubbo_bench *bench = cli->bench;
+    struct buffer *buf = cli->conn.rcv_buf;
+    struct dubbo_res *res = NULL;
+    struct dubbo_res_view view;
+
+    if (bench->verbos)
+    {
+        // 需要输出响应内容时才完整解码
+        res = dubbo_decode(buf);
+        if (res == NULL)
+        {
+            return false;
+        }
+        view.reqid = res->reqid;
+        view.is_evt = res->is_evt;
+        view.is_req = res->is_req;
+        view.is_twoway = res->is_twoway;
+        view.status = res->status;
+        view.type = res->type;
+        view.data = res->data;
+        view.data_sz = res->data_sz;
+        view.payload_sz = res->data_sz;
+    }
+    else if (!dubbo_decode_view(buf, &view))
+    {
+        return false;
+    }
+
+    if (view.is_evt)
+    {
+        // 心跳等事件不计入请求统计; provider 发来的心跳请求需要应答, 否则 provider 会判定连接空闲而关闭
+        if (view.is_req && view.is_twoway)
+        {
+            dubbo_heartbeat_reply(cli->conn.snd_buf, view.reqid);
+            cli_flush_later(cli);
+            bench->hb_replied++;
+        }
+        else if (!view.is_req)
+        {
+            bench->hb_acked++;
+        }
+        if (res)
+        {
+            dubbo_res_release(res);
+        }
+        return true;
+    }
+
+    struct inflight_entry entry;
+    if (!inflight_take(bench->inflight, view.reqid, &entry))
+    {
+        // 已超时或重复的响应, 不计入结果
+        if (bench->measuring)
+        {
+            bench->stats.unmatched_n++;
+        }
+        if (res)
+        {
+            dubbo_res_release(res);
+        }
+        return true;
+    }
+
+    cli_release_slot(cli);
+
+    uint64_t now = now_us();
+    uint64_t lat_us = now - entry.start_us;
+    enum bench_outcome outcome = res_outcome(&view);
+    lb_observe(&bench->lb, cli->target->idx, lat_us, now);
+    bench_ival_record(bench, false, outcome == OUTCOME_OK, lat_us);
+
+    // 开启区间统计时不再输出进度
+    if (bench->ival.lat == NULL && ((bench->req_n - bench->req_left) % 1000) == 0)
+    {
+        fprintf(stderr, "[T%d] 已完成请求 %" PRId64 "\n", bench->id, bench->req_n - bench->req_left);
+    }
+
+    // 同一连接上 reqid 按发送顺序递增
+    bool reorder = view.reqid < cli->last_reqid;
+    if (!reorder)
+    {
+        cli->last_reqid = view.reqid;
+    }
+
+    // 预热期间完成的请求照常执行, 但不计入统计
+    if (bench->measuring)
+    {
+        bench_stats_record(&bench->stats, outcome, lat_us);
+        bench_stats_record(&cli->target->stats, outcome, lat_us);
+        bench_stats_record(&bench->mstats[entry.tag], outcome, lat_us);
+        if (outcome != OUTCOME_OK)
+        {
+            bench_record_error(bench, &view, outcome);
+        }
+        if (reorder)
+        {
+            bench->stats.reorder_n++;
+        }
+    }
+
+    if (res)
+    {
+        cli_print_resp(res);
+        dubbo_res_release(res);
+    }
+    return true;
+}
+
+// 输出完整延迟分布, 单位 ms, "-" 为标准输出
+static void bench_dump_hist(const struct hist *lat, const char *path)
+{
+    FILE *fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (fp == NULL)
+    {
+        LOG_ERROR("打开 %s 失败: %s", path, strerror(errno));
+        return;
+    }
+    hist_print_distribution(lat, fp, 1000.0);
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+}
+
+static void json_add_hist(cJSON *obj, const struct hist *lat)
+{
+    // 单位 ms
+    static const double pcts[] = {50, 75, 90, 95, 99, 99.9, 99.99};
+    static const char *names[] = {"p50", "p75", "p90", "p95", "p99", "p999", "p9999"};
+    cJSON_AddNumberToObject(obj, "count", hist_count(lat));
+    cJSON_AddNumberToObject(obj, "min", hist_min(lat) / 1000.0);
+    cJSON_AddNumberToObject(obj, "mean", hist_mean(lat) / 1000.0);
+    cJSON_AddNumberToObject(obj, "stddev", hist_stddev(lat) / 1000.0);
+    for (size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++)
+    {
+        cJSON_AddNumberToObject(obj, names[i], hist_percentile(lat, pcts[i]) / 1000.0);
+    }
+    cJSON_AddNumberToObject(obj, "max", hist_max(lat) / 1000.0);
+}
+
+// 机器可读的完整压测结果, 供 CI 存档与跨版本对比
+static void bench_dump_json(const char *path, const struct dubbo_args *args, const struct dubbo_async_args *async_args,
+                            const struct bench_stats *stats, const struct bench_stats *tstats, const struct bench_stats *mstats,
+                            struct topk *errors, int thread_n, int conn_n,
+                            const struct timeval *start, const struct timeval *end, double elapsed_sec, const struct hist *replay_lag)
+{
+    cJSON *root = cJSON_CreateObject();
+
+    cJSON *config = cJSON_CreateObject();
+    cJSON *targets = cJSON_CreateArray();
+    for (int i = 0; i < args->target_n; i++)
+    {
+        cJSON *target = cJSON_CreateObject();
+        cJSON_AddStringToObject(target, "host", args->targets[i].host);
+        cJSON_AddStringToObject(target, "port", args->targets[i].port);
+        cJSON_AddNumberToObject(target, "weight", args->targets[i].weight);
+        cJSON_AddItemToArray(targets, target);
+    }
+    cJSON_AddItemToObject(config, "targets", targets);
+    cJSON_AddStringToObject(config, "balance", balance_name(async_args->balance));
+    cJSON *methods = cJSON_CreateArray();
+    for (int i = 0; i < args->method_n; i++)
+    {
+        cJSON *method = cJSON_CreateObject();
+        cJSON_AddStringToObject(method, "service", args->methods[i].service);
+        cJSON_AddStringToObject(method, "method", args->methods[i].method);
+        cJSON_AddStringToObject(method, "args", args->methods[i].args);
+        cJSON_AddStringToObject(method, "attach", args->methods[i].attach);
+        cJSON_AddNumberToObject(method, "weight", args->methods[i].weight);
+        cJSON_AddItemToArray(methods, method);
+    }
+    cJSON_AddItemToObject(config, "methods", methods);
+    if (async_args->corpus)
+    {
+        cJSON_AddStringToObject(config, "corpus", async_args->corpus);
+    }
+    if (async_args->replay)
+    {
+        cJSON *replay = cJSON_CreateObject();
+        cJSON_AddStringToObject(replay, "path", async_args->replay_path);
+        cJSON_AddNumberToObject(replay, "speed", async_args->replay_speed);
+        cJSON_AddNumberToObject(replay, "frames", replay_frame_n(async_args->replay));
+        cJSON_AddNumberToObject(replay, "connections", replay_conn_n(async_args->replay));
+        cJSON_AddItemToObject(config, "replay", replay);
+    }
+    cJSON_AddNumberToObject(config, "seed", (double)async_args->seed);
+    if (async_args->dataset)
+    {
+        cJSON *dataset = cJSON_CreateObject();
+        cJSON_AddStringToObject(dataset, "path", async_args->dataset);
+        cJSON_AddBoolToObject(dataset, "shuffle", async_args->dataset_shuffle);
+        cJSON_AddBoolToObject(dataset, "wrap", async_args->dataset_wrap);
+        cJSON_AddItemToObject(config, "dataset", dataset);
+    }
+    cJSON_AddNumberToObject(config, "threads", thread_n);
+    cJSON_AddNumberToObject(config, "connections", conn_n);
+    cJSON_AddNumberToObject(config, "pipeline", async_args->pipe_n);
+    cJSON_AddNumberToObject(config, "requests", async_args->req_n);
+    cJSON_AddNumberToObject(config, "duration_ms", async_args->duration_ms);
+    cJSON_AddNumberToObject(config, "warmup_ms", async_args->warmup_ms);
+    cJSON_AddNumberToObject(config, "rate", async_args->rate);
+    if (async_args->profile)
+    {
+        const struct profile *pf = async_args->profile;
+        cJSON *profile = cJSON_CreateObject();
+        cJSON_AddStringToObject(profile, "kind", pf->kind == PROFILE_RATE ? "qps" : "c");
+        if (async_args->qps_series)
+        {
+            // 逐秒的点可能有数万个, 只记录来源
+            cJSON_AddStringToObject(profile, "series", async_args->qps_series);
+            cJSON_AddNumberToObject(profile, "speed", async_args->replay_speed);
+            cJSON_AddNumberToObject(profile, "point_n", pf->point_n);
+        }
+        else
+        {
+            cJSON *points = cJSON_CreateArray();
+            for (int i = 0; i < pf->point_n; i++)
+            {
+                cJSON *point = cJSON_CreateObject();
+                cJSON_AddNumberToObject(point, "t_ms", pf->points[i].t_ms);
+                cJSON_AddNumberToObject(point, "value", pf->points[i].val);
+                cJSON_AddStringToObject(point, "phase", pf->points[i].name);
+                cJSON_AddItemToArray(points, point);
+            }
+            cJSON_AddItemToObject(profile, "points", points);
+        }
+        cJSON_AddItemToObject(config, "profile", profile);
+    }
+    cJSON_AddNumberToObject(config, "timeout_ms", args->timeout.tv_sec * 1000);
+    cJSON_AddNumberToObject(config, "heartbeat_ms", async_args->heartbeat_ms);
+    cJSON_AddNumberToObject(config, "req_timeout_ms", async_args->req_timeout_ms > 0 ? async_args->req_timeout_ms : args->timeout.tv_sec * 1000);
+    cJSON_AddItemToObject(root, "config", config);
+
+    cJSON_AddNumberToObject(root, "start_ms", (double)start->tv_sec * 1000 + start->tv_usec / 1000);
+    cJSON_AddNumberToObject(root, "end_ms", (double)end->tv_sec * 1000 + end->tv_usec / 1000);
+    cJSON_AddNumberToObject(root, "duration_s", elapsed_sec);
+
+    cJSON *counts = cJSON_CreateObject();
+    cJSON_AddNumberToObject(counts, "total", stats->done_n);
+    cJSON_AddNumberToObject(counts, "ok", stats->ok_n);
+    cJSON_AddNumberToObject(counts, "fail", stats->ko_n);
+    cJSON_AddNumberToObject(counts, "timeout", stats->timeout_n);
+    cJSON_AddNumberToObject(counts, "late_or_dup", stats->unmatched_n);
+    cJSON_AddNumberToObject(counts, "reorder", stats->reorder_n);
+    cJSON_AddItemToObject(root, "counts", counts);
+
+    cJSON *outcomes = cJSON_CreateObject();
+    for (int i = 0; i < OUTCOME_N; i++)
+    {
+        cJSON_AddNumberToObject(outcomes, outcome_names[i], stats->outcome_n[i]);
+    }
+    cJSON_AddItemToObject(root, "outcomes", outcomes);
+
+    cJSON *jerrors = cJSON_CreateArray();
+    const struct topk_item *items;
+    int error_n = topk_sorted(errors, &items);
+    for (int i = 0; i < error_n; i++)
+    {
+        cJSON *e = cJSON_CreateObject();
+        cJSON_AddStringToObject(e, "error", items[i].key);
+        cJSON_AddNumberToObject(e, "count", items[i].count);
+        cJSON_AddNumberToObject(e, "max_overcount", items[i].err);
+        cJSON_AddItemToArray(jerrors, e);
+    }
+    cJSON_AddItemToObject(root, "errors", jerrors);
+
+    cJSON *throughput = cJSON_CreateObject();
+    cJSON_AddNumberToObject(throughput, "qps", elapsed_sec < 0.001 ? 0 : stats->done_n / elapsed_sec);
+    cJSON_AddNumberToObject(throughput, "send", stats->send_n);
+    cJSON_AddNumberToObject(throughput, "write", stats->write_n);
+    cJSON_AddNumberToObject(throughput, "req_per_write", stats->write_n ? (double)stats->send_n / stats->write_n : 0);
+    cJSON_AddItemToObject(root, "throughput", throughput);
+
+    cJSON *bytes = cJSON_CreateObject();
+    cJSON_AddNumberToObject(bytes, "in", stats->bytes_in);
+    cJSON_AddNumberToObject(bytes, "out", stats->bytes_out);
+    cJSON_AddNumberToObject(bytes, "in_per_sec", elapsed_sec < 0.001 ? 0 : stats->bytes_in / elapsed_sec);
+    cJSON_AddNumberToObject(bytes, "out_per_sec", elapsed_sec < 0.001 ? 0 : stats->bytes_out / elapsed_sec);
+    cJSON_AddItemToObject(root, "bytes", bytes);
+
+    if (replay_lag)
+    {
+        cJSON *lag = cJSON_CreateObject();
+        json_add_hist(lag, replay_lag);
+        cJSON_AddItemToObject(root, "replay_lag", lag);
+    }
+
+    cJSON *latency = cJSON_CreateObject();
+    json_add_hist(latency, stats->lat);
+    cJSON_AddItemToObject(root, "latency_ms", latency);
+    cJSON *latency_fail = cJSON_CreateObject();
+    json_add_hist(latency_fail, stats->lat_ko);
+    cJSON_AddItemToObject(root, "latency_fail_ms", latency_fail);
+
+    cJSON *providers = cJSON_CreateArray();
+    for (int i = 0; i < args->target_n; i++)
+    {
+        cJSON *provider = cJSON_CreateObject();
+        cJSON_AddStringToObject(provider, "host", args->targets[i].host);
+        cJSON_AddStringToObject(provider, "port", args->targets[i].port);
+        cJSON_AddNumberToObject(provider, "total", tstats[i].done_n);
+        cJSON_AddNumberToObject(provider, "ok", tstats[i].ok_n);
+        cJSON_AddNumberToObject(provider, "fail", tstats[i].ko_n);
+        cJSON_AddNumberToObject(provider, "timeout", tstats[i].timeout_n);
+        cJSON_AddNumberToObject(provider, "qps", elapsed_sec < 0.001 ? 0 : tstats[i].done_n / elapsed_sec);
+        cJSON *tlat = cJSON_CreateObject();
+        json_add_hist(tlat, tstats[i].lat);
+        cJSON_AddItemToObject(provider, "latency_ms", tlat);
+        cJSON_AddItemToArray(providers, provider);
+    }
+    cJSON_AddItemToObject(root, "providers", providers);
+
+    cJSON *mresults = cJSON_CreateArray();
+    for (int i = 0; i < args->method_n; i++)
+    {
+        cJSON *mresult = cJSON_CreateObject();
+        cJSON_AddStringToObject(mresult, "service", args->methods[i].service);
+        cJSON_AddStringToObject(mresult, "method", args->methods[i].method);
+        cJSON_AddNumberToObject(mresult, "total", mstats[i].done_n);
+        cJSON_AddNumberToObject(mresult, "ok", mstats[i].ok_n);
+        cJSON_AddNumberToObject(mresult, "fail", mstats[i].ko_n);
+        cJSON_AddNumberToObject(mresult, "timeout", mstats[i].timeout_n);
+        cJSON_AddNumberToObject(mresult, "qps", elapsed_sec < 0.001 ? 0 : mstats[i].done_n / elapsed_sec);
+        cJSON *mlat = cJSON_CreateObject();
+        json_add_hist(mlat, mstats[i].lat);
+        cJSON_AddItemToObject(mresult, "latency_ms", mlat);
+        cJSON_AddItemToArray(mresults, mresult);
+    }
+    cJSON_AddItemToObject(root, "methods", mresults);
+
+    char *json = cJSON_Print(root);
+    cJSON_Delete(root);
+
+    FILE *fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (fp == NULL)
+    {
+        LOG_ERROR("打开 %s 失败: %s", path, strerror(errno));
+    }
+    else
+    {
+        fprintf(fp, "%s\n", json);
+        if (fp != stdout)
+        {
+            fclose(fp);
+        }
+    }
+    free(json);
+}
+
+// 主线程的区间统计: 按间隔从各工作线程取走区间数据, 合并后输出一行
+struct bench_report
+{
+    struct reporter *reporter;
+    const struct profile *profile;
+    struct dubbo_bench **benchs;
+    int bench_n;
+    long interval_ms;
+    struct hist *lat;
+    uint64_t start_us;
+    uint64_t last_us;
+};
+
+// final 为最后一个区间, 没有完成的请求时不输出
+static void bench_report_collect(struct bench_report *rep, bool final)
+{
+    struct report_row row;
+    memset(&row, 0, sizeof(row));
+    hist_reset(rep->lat);
+
+    bool measuring = false;
+    int phase = 0;
+    for (int i = 0; i < rep->bench_n; i++)
+    {
+        struct dubbo_bench *bench = rep->benchs[i];
+        // 锁内只交换直方图指针, 合并在锁外进行
+        struct hist *lat = bench->ival_spare;
+        pthread_mutex_lock(&bench->ival_lock);
+        bench->ival_spare = bench->ival.lat;
+        bench->ival.lat = lat;
+        row.ok_n += bench->ival.ok_n;
+        row.ko_n += bench->ival.ko_n;
+        row.timeout_n += bench->ival.timeout_n;
+        bench->ival.ok_n = 0;
+        bench->ival.ko_n = 0;
+        bench->ival.timeout_n = 0;
+        pthread_mutex_unlock(&bench->ival_lock);
+
+        hist_merge(rep->lat, bench->ival_spare);
+        hist_reset(bench->ival_spare);
+        row.inflight_n += __atomic_load_n(&bench->ival_inflight, __ATOMIC_RELAXED);
+        measuring |= __atomic_load_n(&bench->measuring, __ATOMIC_RELAXED);
+        int bench_phase = __atomic_load_n(&bench->phase, __ATOMIC_RELAXED);
+        if (bench_phase > phase)
+        {
+            phase = bench_phase;
+        }
+    }
+
+    if (final && row.ok_n + row.ko_n + row.timeout_n == 0)
+    {
+        return;
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t now = now_us();
+    row.ts_ms = (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    row.elapsed_sec = (now - rep->start_us) / 1000000.0;
+    row.ival_sec = (now - rep->last_us) / 1000000.0;
+    // 按负载曲线压测时以曲线阶段名代替 measure
+    row.phase = !measuring ? "warmup" : rep->profile ? profile_phase_name(rep->profile, phase) : "measure";
+    row.lat = rep->lat;
+    rep->last_us = now;
+    reporter_write(rep->reporter, &row);
+}
+
+static int bench_on_report(struct aeEventLoop *el, long long id, void *ud)
+{
+    struct bench_report *rep = (struct bench_report *)ud;
+    bench_report_collect(rep, false);
+    return rep->interval_ms;
+}
+
+// 所有工作线程结束后输出最后一个不完整的区间
+static int bench_on_report_check(struct aeEventLoop *el, long long id, void *ud)
+{
+    struct bench_report *rep = (struct bench_report *)ud;
+    for (int i = 0; i < rep->bench_n; i++)
+    {
+        if (!__atomic_load_n(&rep->benchs[i]->finished, __ATOMIC_ACQUIRE))
+        {
+            return BENCH_CHECK_STOP_MS;
+        }
+    }
+    bench_report_collect(rep, true);
+    aeStop(el);
+    return AE_NOMORE;
+}
+
+static void bench_report_run(struct bench_report *rep)
+{
+    struct aeEventLoop *el = aeCreateEventLoop(BENCH_REPORT_LOOP_SZ);
+    assert(el);
+    rep->lat = hist_create();
+    rep->start_us = now_us();
+    rep->last_us = rep->start_us;
+    if (AE_ERR == aeCreateTimeEvent(el, rep->interval_ms, bench_on_report, rep, NULL) ||
+        AE_ERR == aeCreateTimeEvent(el, BENCH_CHECK_STOP_MS, bench_on_report_check, rep, NULL))
+    {
+        LOG_ERROR("创建区间统计定时器失败");
+    }
+    else
+    {
+        aeMain(el);
+    }
+    hist_release(rep->lat);
+    aeDeleteEventLoop(el);
+}
+
+static void bench_workload_release(struct bench_workload *wl)
+{
+    for (int i = 0; i < wl->method_n; i++)
+    {
+        if (wl->frames[i])
+        {
+            buf_release(wl->frames[i]);
+        }
+        if (wl->tpls[i])
+        {
+            argtpl_release(wl->tpls[i]);
+        }
+        if (wl->req_tpls[i])
+        {
+            dubbo_req_tpl_release(wl->req_tpls[i]);
+        }
+    }
+    free(wl->frames);
+    free(wl->tpls);
+    free(wl->req_tpls);
+    if (wl->data)
+    {
+        dataset_close(wl->data);
+    }
+    if (wl->corpus)
+    {
+        corpus_close(wl->corpus);
+    }
+    if (wl->mix)
+    {
+        alias_release(wl->mix);
+    }
+    free(wl);
+}
+
+static bool bench_workload_uses_data(const struct bench_workload *wl)
+{
+    for (int i = 0; i < wl->method_n; i++)
+    {
+        if (wl->tpls[i] && argtpl_uses_data(wl->tpls[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 以数据集首行试渲染, 提前发现模板错误
+static bool bench_workload_check_tpl(const struct bench_workload *wl, const struct argtpl *tpl, const struct dubbo_method *m)
+{
+    const char *line = "";
+    size_t len = 0;
+    if (wl->data)
+    {
+        struct dataset_cursor *cur = dataset_cursor_create(wl->data, 0, 1, 1);
+        dataset_next(cur, &line, &len);
+        dataset_cursor_release(cur);
+    }
+    struct argtpl_ctx ctx;
+    argtpl_ctx_init(&ctx, 0, 0, 1);
+    struct buffer *buf = buf_create(CLI_INIT_BUF_SZ);
+    argtpl_render(tpl, &ctx, line, len, buf);
+    buf_appendInt8(buf, 0);
+    cJSON *json_args = cJSON_Parse(buf_peek(buf));
+    bool ok = json_args && cJSON_IsArray(json_args);
+    if (!ok)
+    {
+        LOG_ERROR("%s.%s 参数模板渲染后不是 JSON 数组: %s", m->service, m->method, buf_peek(buf));
+    }
+    cJSON_Delete(json_args);
+    buf_release(buf);
+    return ok;
+}
+
+// 每个方法的请求只编码一次, 发送时复制并改写 reqid; 参数引用数据集的方法只预编码 body 中参数之前的部分
+static struct bench_workload *bench_workload_create(const struct dubbo_args *args, const struct dubbo_async_args *async_args)
+{
+    struct bench_workload *wl = calloc(1, sizeof(*wl));
+    assert(wl);
+    wl->method_n = args->method_n;
+    wl->frames = calloc(wl->method_n, sizeof(*wl->frames));
+    assert(wl->frames);
+    wl->tpls = calloc(wl->method_n, sizeof(*wl->tpls));
+    assert(wl->tpls);
+    wl->req_tpls = calloc(wl->method_n, sizeof(*wl->req_tpls));
+    assert(wl->req_tpls);
+
+    if (async_args->corpus)
+    {
+        // 方法下标由语料中的每一帧决定, 不需要编码与抽样
+        wl->corpus = corpus_open(async_args->corpus);
+        if (wl->corpus == NULL)
+        {
+            bench_workload_release(wl);
+            return NULL;
+        }
+        return wl;
+    }
+
+    if (async_args->replay)
+    {
+        // 录制的请求帧原样发送, 不需要编码
+        wl->replay = async_args->replay;
+        return wl;
+    }
+
+    if (async_args->dataset)
+    {
+        wl->data = dataset_open(async_args->dataset, async_args->dataset_shuffle, async_args->dataset_wrap);
+        if (wl->data == NULL)
+        {
+            bench_workload_release(wl);
+            return NULL;
+        }
+    }
+
+    double *weights = calloc(wl->method_n, sizeof(*weights));
+    assert(weights);
+    for (int i = 0; i < wl->method_n; i++)
+    {
+        const struct dubbo_method *m = &args->methods[i];
+        weights[i] = m->weight;
+
+        struct argtpl *tpl = argtpl_compile(m->args, wl->data);
+        if (tpl == NULL)
+        {
+            goto fail;
+        }
+        if (!argtpl_is_static(tpl))
+        {
+            wl->tpls[i] = tpl;
+            wl->templated = true;
+            if (!bench_workload_check_tpl(wl, tpl, m))
+            {
+                goto fail;
+            }
+            wl->req_tpls[i] = dubbo_req_tpl_create(m->service, m->method, m->attach);
+            if (wl->req_tpls[i] == NULL)
+            {
+                LOG_ERROR("Dubbo 请求编码失败: %s.%s", m->service, m->method);
+                goto fail;
+            }
+            continue;
+        }
+        argtpl_release(tpl);
+
+        struct dubbo_req *req = dubbo_req_create(m->service, m->method, m->args, m->attach);
+        if (req == NULL)
+        {
+            goto fail;
+        }
+        wl->frames[i] = dubbo_encode(req);
+        dubbo_req_release(req);
+        if (wl->frames[i] == NULL)
+        {
+            LOG_ERROR("Dubbo 请求编码失败: %s.%s", m->service, m->method);
+            goto fail;
+        }
+    }
+
+    if (wl->data && !bench_workload_uses_data(wl))
+    {
+        LOG_ERROR("指定了数据集, 但没有方法的参数引用数据集字段 ({{$N}} 或 {{$name}})");
+        goto fail;
+    }
+
+    if (wl->method_n > 1)
+    {
+        wl->mix = alias_create(weights, wl->method_n);
+        if (wl->mix == NULL)
+        {
+            LOG_ERROR("方法权重非法");
+            goto fail;
+        }
+    }
+    free(weights);
+    return wl;
+
+fail:
+    free(weights);
+    bench_workload_release(wl);
+    return NULL;
+}
+
+static void bench_print_latency(const char *tag, const struct hist *lat)
+{
+    fprintf(stderr, "\x1B[1;32m[%s]\x1B[0m MIN %.2fms, AVG %.2fms, P50 %.2fms, P90 %.2fms, P99 %.2fms, P99.9 %.2fms, MAX %.2fms\n",
+            tag, hist_min(lat) / 1000.0, hist_mean(lat) / 1000.0,
+            hist_percentile(lat, 50) / 1000.0, hist_percentile(lat, 90) / 1000.0,
+            hist_percentile(lat, 99) / 1000.0, hist_percentile(lat, 99.9) / 1000.0,
+            hist_max(lat) / 1000.0);
+}
+
+// 按结果分类输出计数, 失败响应的延迟与最常见的错误
+static void bench_print_outcomes(const struct bench_stats *stats, struct topk *errors)
+{
+    fprintf(stderr, "\x1B[1;33m[OUTCOME]\x1B[0m");
+    const char *sep = " ";
+    for (int i = 0; i < OUTCOME_N; i++)
+    {
+        if (stats->outcome_n[i])
+        {
+            fprintf(stderr, "%s%s %" PRId64 " (%.2f%%)", sep, outcome_names[i], stats->outcome_n[i],
+                    stats->done_n ? 100.0 * stats->outcome_n[i] / stats->done_n : 0);
+            sep = ", ";
+        }
+    }
+    fprintf(stderr, "\n");
+    if (hist_count(stats->lat_ko))
+    {
+        bench_print_latency("LATENCY FAIL", stats->lat_ko);
     }
 
-    if (res->ok)
+    const struct topk_item *items;
+    int n = topk_sorted(errors, &items);
+    for (int i = 0; i < n && i < BENCH_ERROR_SHOW_N; i++)
     {
-        cli->ok_n++;
+        fprintf(stderr, "\x1B[1;33m[ERROR]\x1B[0m %" PRId64 " %s\n", items[i].count, items[i].key);
     }
-    else
+}
+
+bool dubbo_compile_corpus(struct dubbo_args *args, struct dubbo_async_args *async_args, const char *path)
+{
+    struct bench_workload *wl = bench_workload_create(args, async_args);
+    if (wl == NULL)
     {
-        cli->ok_n++;
+        return false;
     }
 
-    if (cli->verbos)
+    char **names = calloc(wl->method_n, sizeof(*names));
+    assert(names);
+    for (int i = 0; i < wl->method_n; i++)
     {
-        if (res->is_evt)
+        int n = asprintf(&names[i], "%s.%s", args->methods[i].service, args->methods[i].method);
+        assert(n > 0);
+    }
+    struct corpus_writer *w = corpus_writer_create(path, (const char **)names, wl->method_n);
+    for (int i = 0; i < wl->method_n; i++)
+    {
+        free(names[i]);
+    }
+    free(names);
+    if (w == NULL)
+    {
+        bench_workload_release(wl);
+        return false;
+    }
+
+    // 每行按权重抽取方法 (固定种子), 参数校验为 JSON 数组后同压测时一样经请求模板编码, 语料帧与实时渲染的帧逐字节相同
+    // 没有数据集时生成 -n 帧
+    struct dataset_cursor *cur = wl->data ? dataset_cursor_create(wl->data, 0, 1, 1) : NULL;
+    struct buffer *args_buf = buf_create(CLI_INIT_BUF_SZ);
+    struct buffer *frame = buf_create(CLI_INIT_BUF_SZ);
+    struct argtpl_ctx ctx;
+    argtpl_ctx_init(&ctx, async_args->seed, 0, 1);
+    uint64_t rng = 0x2545F4914F6CDD1DULL;
+    int64_t skip_n = 0;
+    bool ok = true;
+    const char *line = NULL;
+    size_t len = 0;
+    while (ok && (async_args->req_n <= 0 || corpus_writer_frame_n(w) < (uint64_t)async_args->req_n) &&
+           (cur == NULL || dataset_next(cur, &line, &len)))
+    {
+        int m = wl->mix ? alias_sample(wl->mix, &rng) : 0;
+        if (wl->tpls[m] == NULL)
         {
-            printf("<res seq=%" PRId64 "> [EVT]", res->reqid);
+            ok = corpus_writer_add(w, m, wl->frames[m]);
+            continue;
         }
-        else if (res->data_sz)
+
+        buf_retrieveAll(args_buf);
+        argtpl_render(wl->tpls[m], &ctx, line, len, args_buf);
+        size_t args_sz = buf_readable(args_buf);
+        buf_appendInt8(args_buf, 0);
+        cJSON *json_args = cJSON_Parse(buf_peek(args_buf));
+        bool valid = json_args && cJSON_IsArray(json_args);
+        cJSON_Delete(json_args);
+        if (!valid)
         {
-            // 返回 json, 不应该有 NULL 存在, 且非 NULL 结尾
-            char *json = malloc(res->data_sz + 1);
-            assert(json);
-            memcpy(json, res->data, res->data_sz);
-            json[res->data_sz] = '\0';
+            skip_n++;
+            continue;
+        }
+        buf_retrieveAll(frame);
+        dubbo_req_tpl_encode(wl->req_tpls[m], dubbo_next_reqid(), buf_peek(args_buf), args_sz, frame);
+        ok = corpus_writer_add(w, m, frame);
+    }
 
-            cJSON *resp = NULL;
-            if ((json[0] == '[' || json[0] == '{') && (resp = cJSON_Parse(json)))
-            {
-                if (res->ok)
-                {
-                    printf("<res seq=%" PRId64 "> [\x1B[1;32mSUCC\x1B[0m] %s\n", res->reqid, cJSON_Print(resp));
-                }
-                else
-                {
-                    printf("<res seq=%" PRId64 "> [\x1B[1;31mFAIL\x1B[0m] [\x1B[1;31m%s\x1B[0m] %s\n", res->reqid, res->desc, cJSON_Print(resp));
-                }
-                cJSON_Delete(resp);
-            }
-            else
-            {
-                if (res->ok)
-                {
-                    printf("<res seq=%" PRId64 "> [\x1B[1;32mSUCC\x1B[0m] %s\n", res->reqid, json);
-                }
-                else
-                {
-                    printf("<res seq=%" PRId64 "> [\x1B[1;31mFAIL\x1B[0m] %s\n", res->reqid, json);
-                }
-            }
-            free(json);
+    uint64_t frame_n = corpus_writer_frame_n(w);
+    ok = corpus_writer_close(w) && ok;
+    if (ok)
+    {
+        fprintf(stderr, "\x1B[1;32m[CORPUS]\x1B[0m %s: FRAMES %" PRIu64 ", SKIPPED %" PRId64 "\n", path, frame_n, skip_n);
+    }
+    buf_release(args_buf);
+    buf_release(frame);
+    if (cur)
+    {
+        dataset_cursor_release(cur);
+    }
+    bench_workload_release(wl);
+    return ok;
+}
+
+// 一轮压测各线程合并后的结果
+struct bench_result
+{
+    struct bench_stats stats;
+    struct bench_stats *tstats;
+    struct bench_stats *mstats;
+    struct topk *errors;
+    struct timeval start;
+    struct timeval end;
+    double elapsed_sec;
+    int thread_n;  /* 计划线程数 */
+    int started_n; /* 实际启动的线程数 */
+    int conn_n;
+    struct hist *replay_lag; /* 回放实际发送落后预期的时间 */
+    uint64_t replay_sent;
+    int64_t hb_sent;
+    int64_t hb_acked;
+    int64_t hb_replied;
+};
+
+static void bench_result_init(struct bench_result *res, const struct dubbo_args *args)
+{
+    memset(res, 0, sizeof(*res));
+    bench_stats_init(&res->stats);
+    res->errors = topk_create(BENCH_ERROR_TOPK);
+    res->replay_lag = hist_create();
+    res->tstats = calloc(args->target_n, sizeof(*res->tstats));
+    assert(res->tstats);
+    for (int i = 0; i < args->target_n; i++)
+    {
+        bench_stats_init(&res->tstats[i]);
+    }
+    res->mstats = calloc(args->method_n, sizeof(*res->mstats));
+    assert(res->mstats);
+    for (int i = 0; i < args->method_n; i++)
+    {
+        bench_stats_init(&res->mstats[i]);
+    }
+}
+
+static void bench_result_destroy(struct bench_result *res, const struct dubbo_args *args)
+{
+    bench_stats_destroy(&res->stats);
+    topk_release(res->errors);
+    hist_release(res->replay_lag);
+    for (int i = 0; i < args->target_n; i++)
+    {
+        bench_stats_destroy(&res->tstats[i]);
+    }
+    free(res->tstats);
+    for (int i = 0; i < args->method_n; i++)
+    {
+        bench_stats_destroy(&res->mstats[i]);
+    }
+    free(res->mstats);
+}
+
+// 执行一轮压测并合并结果, 阻塞直到所有压测线程结束; 负载初始化失败返回 false
+static bool bench_run(struct dubbo_args *args, struct dubbo_async_args *async_args, struct reporter *reporter, struct capture *capture,
+                      struct bench_result *res)
+{
+    int thread_n = async_args->thread_n > 0 ? async_args->thread_n : 1;
+    if (thread_n > async_args->conn_n * args->target_n)
+    {
+        thread_n = async_args->conn_n * args->target_n;
+    }
+    if (async_args->req_n > 0 && thread_n > async_args->req_n)
+    {
+        thread_n = async_args->req_n;
+    }
+
+    struct bench_workload *wl = bench_workload_create(args, async_args);
+    if (wl == NULL)
+    {
+        return false;
+    }
+
+    union sockaddr_all *addrs = calloc(args->target_n, sizeof(*addrs));
+    assert(addrs);
+    for (int i = 0; i < args->target_n; i++)
+    {
+        if (!sa_resolve(args->targets[i].host, &addrs[i]))
+        {
+            PANIC("%s DNS解析失败", args->targets[i].host);
         }
-        else if (res->data_sz == 0)
+        addrs[i].v4.sin_port = htons(atoi(args->targets[i].port));
+    }
+
+    struct dubbo_bench **benchs = calloc(thread_n, sizeof(*benchs));
+    assert(benchs);
+    for (int i = 0; i < thread_n; i++)
+    {
+        benchs[i] = bench_create(args, async_args, wl, addrs, i, thread_n);
+        if (capture)
+        {
+            benchs[i]->capture = capture_buf_create(capture);
+        }
+    }
+    free(addrs);
+
+    stop_signal_install();
+
+    int started_n = 0;
+    for (int i = 0; i < thread_n; i++)
+    {
+        if (pthread_create(&benchs[i]->tid, NULL, bench_thread, benchs[i]) != 0)
+        {
+            LOG_ERROR("创建压测线程失败: %s", strerror(errno));
+            break;
+        }
+        started_n++;
+    }
+
+    if (reporter)
+    {
+        struct bench_report rep;
+        memset(&rep, 0, sizeof(rep));
+        rep.reporter = reporter;
+        rep.profile = async_args->profile;
+        rep.benchs = benchs;
+        rep.bench_n = started_n;
+        rep.interval_ms = async_args->report_interval_ms;
+        bench_report_run(&rep);
+    }
+
+    // 各线程结果只在结束后合并, 统计窗口取各线程窗口的并集
+    for (int i = 0; i < started_n; i++)
+    {
+        pthread_join(benchs[i]->tid, NULL);
+        bench_stats_merge(&res->stats, &benchs[i]->stats);
+        topk_merge(res->errors, benchs[i]->errors);
+        for (int j = 0; j < args->target_n; j++)
+        {
+            bench_stats_merge(&res->tstats[j], &benchs[i]->targets[j].stats);
+        }
+        for (int j = 0; j < args->method_n; j++)
+        {
+            bench_stats_merge(&res->mstats[j], &benchs[i]->mstats[j]);
+        }
+        res->conn_n += benchs[i]->cli_n;
+        res->hb_sent += benchs[i]->hb_sent;
+        res->hb_acked += benchs[i]->hb_acked;
+        res->hb_replied += benchs[i]->hb_replied;
+        if (benchs[i]->replay_lag)
+        {
+            hist_merge(res->replay_lag, benchs[i]->replay_lag);
+            res->replay_sent += benchs[i]->replay_pos;
+        }
+        if (!benchs[i]->measuring)
+        {
+            continue;
+        }
+        if (res->start.tv_sec == 0 || timercmp(&benchs[i]->start, &res->start, <))
+        {
+            res->start = benchs[i]->start;
+        }
+        if (timercmp(&benchs[i]->end, &res->end, >))
         {
-            printf("<res seq=%" PRId64 "> [\x1B[1;32mSUCC\x1B[0m] NULL\n", res->reqid);
+            res->end = benchs[i]->end;
         }
     }
 
-    dubbo_res_release(res);
+    stop_signal_restore();
+
+    res->elapsed_sec = ((double)res->end.tv_sec + 1.0e-6 * res->end.tv_usec) -
+                       ((double)res->start.tv_sec + 1.0e-6 * res->start.tv_usec);
+    res->thread_n = thread_n;
+    res->started_n = started_n;
+
+    for (int i = 0; i < thread_n; i++)
+    {
+        bench_release(benchs[i]);
+    }
+    free(benchs);
+    bench_workload_release(wl);
     return true;
 }
 
+static struct reporter *bench_reporter_create(const struct dubbo_async_args *async_args, bool *ok)
+{
+    *ok = true;
+    if (async_args->report_interval_ms <= 0)
+    {
+        return NULL;
+    }
+    struct reporter *reporter = reporter_create(async_args->report_out, async_args->report_fmt);
+    if (reporter == NULL)
+    {
+        LOG_ERROR("打开 %s 失败: %s", async_args->report_out, strerror(errno));
+        *ok = false;
+    }
+    return reporter;
+}
+
 bool dubbo_bench_async(struct dubbo_args *args, struct dubbo_async_args *async_args)
 {
-    struct dubbo_client *cli = cli_create(args, async_args);
-    if (cli == NULL)
+    bool reporter_ok;
+    struct reporter *reporter = bench_reporter_create(async_args, &reporter_ok);
+    if (!reporter_ok)
+    {
+        return false;
+    }
+
+    struct capture *capture = NULL;
+    if (async_args->record)
+    {
+        capture = capture_open(async_args->record);
+        if (capture == NULL)
+        {
+            if (reporter)
+            {
+                reporter_release(reporter);
+            }
+            return false;
+        }
+    }
+
+    struct bench_result res;
+    bench_result_init(&res, args);
+    bool run_ok = bench_run(args, async_args, reporter, capture, &res);
+    if (reporter)
+    {
+        reporter_release(reporter);
+    }
+    uint64_t capture_n = 0;
+    uint64_t capture_sz = 0;
+    bool capture_ok = true;
+    if (capture)
+    {
+        capture_n = capture_frame_n(capture);
+        capture_sz = capture_bytes(capture);
+        capture_ok = capture_close(capture);
+    }
+    if (!run_ok)
+    {
+        bench_result_destroy(&res, args);
+        return false;
+    }
+
+    struct bench_stats *stats = &res.stats;
+    double elapsed_sec = res.elapsed_sec;
+    double qps = elapsed_sec < 0.001 ? 0 : stats->done_n / elapsed_sec;
+    fprintf(stderr, "\x1B[1;32m[SUMMARY]\x1B[0m THREAD %d, CONN %d, COST %.2fs, REQ %" PRId64 ", SUCC %" PRId64 ", FAIL %" PRId64 ", QPS %.f\n",
+            res.started_n, res.conn_n, elapsed_sec, stats->done_n, stats->ok_n, stats->ko_n, qps);
+    fprintf(stderr, "\x1B[1;32m[WRITE]\x1B[0m SEND %" PRId64 ", WRITE %" PRId64 ", REQ/WRITE %.2f\n",
+            stats->send_n, stats->write_n, stats->write_n ? (double)stats->send_n / stats->write_n : 0);
+    fprintf(stderr, "\x1B[1;32m[INFLIGHT]\x1B[0m TIMEOUT %" PRId64 ", LATE/DUP %" PRId64 ", REORDER %" PRId64 "\n",
+            stats->timeout_n, stats->unmatched_n, stats->reorder_n);
+    bench_print_latency("LATENCY", stats->lat);
+    if (res.hb_sent || res.hb_replied)
+    {
+        fprintf(stderr, "\x1B[1;32m[HEARTBEAT]\x1B[0m SENT %" PRId64 ", ACK %" PRId64 ", REPLIED %" PRId64 ", 不计入请求统计\n",
+                res.hb_sent, res.hb_acked, res.hb_replied);
+    }
+    if (stats->ok_n != stats->done_n || stats->outcome_n[OUTCOME_CONN_ERROR] || stats->outcome_n[OUTCOME_DECODE_ERROR])
+    {
+        bench_print_outcomes(stats, res.errors);
+    }
+    if (args->target_n > 1)
+    {
+        fprintf(stderr, "\x1B[1;32m[PROVIDER]\x1B[0m BALANCE %s\n", balance_name(async_args->balance));
+        for (int i = 0; i < args->target_n; i++)
+        {
+            struct bench_stats *ts = &res.tstats[i];
+            fprintf(stderr, "\x1B[1;32m[PROVIDER]\x1B[0m %s:%s, WEIGHT %d, REQ %" PRId64 ", SUCC %" PRId64 ", FAIL %" PRId64 ", TIMEOUT %" PRId64
+                            ", QPS %.f, AVG %.2fms, P50 %.2fms, P99 %.2fms, P99.9 %.2fms\n",
+                    args->targets[i].host, args->targets[i].port, args->targets[i].weight,
+                    ts->done_n, ts->ok_n, ts->ko_n, ts->timeout_n, elapsed_sec < 0.001 ? 0 : ts->done_n / elapsed_sec,
+                    hist_mean(ts->lat) / 1000.0, hist_percentile(ts->lat, 50) / 1000.0,
+                    hist_percentile(ts->lat, 99) / 1000.0, hist_percentile(ts->lat, 99.9) / 1000.0);
+        }
+    }
+    if (args->method_n > 1)
+    {
+        for (int i = 0; i < args->method_n; i++)
+        {
+            struct bench_stats *ms = &res.mstats[i];
+            fprintf(stderr, "\x1B[1;32m[METHOD]\x1B[0m %s.%s, WEIGHT %g, REQ %" PRId64 " (%.1f%%), SUCC %" PRId64 ", FAIL %" PRId64 ", TIMEOUT %" PRId64
+                            ", QPS %.f, AVG %.2fms, P50 %.2fms, P99 %.2fms, P99.9 %.2fms\n",
+                    args->methods[i].service, args->methods[i].method, args->methods[i].weight,
+                    ms->done_n, stats->done_n ? 100.0 * ms->done_n / stats->done_n : 0, ms->ok_n, ms->ko_n, ms->timeout_n,
+                    elapsed_sec < 0.001 ? 0 : ms->done_n / elapsed_sec,
+                    hist_mean(ms->lat) / 1000.0, hist_percentile(ms->lat, 50) / 1000.0,
+                    hist_percentile(ms->lat, 99) / 1000.0, hist_percentile(ms->lat, 99.9) / 1000.0);
+        }
+    }
+    if (async_args->warmup_ms > 0)
+    {
+        fprintf(stderr, "\x1B[1;32m[SUMMARY]\x1B[0m WARMUP %.2fs, 预热期间完成的请求不计入统计\n", async_args->warmup_ms / 1000.0);
+    }
+    if (async_args->profile)
+    {
+        const struct profile *pf = async_args->profile;
+        fprintf(stderr, "\x1B[1;32m[SUMMARY]\x1B[0m PROFILE %s, %d POINTS, %.2fs, PEAK %.f\n",
+                pf->kind == PROFILE_RATE ? "QPS" : "CONCURRENCY", pf->point_n, profile_duration_ms(pf) / 1000.0, profile_max(pf));
+        if (async_args->qps_series)
+        {
+            fprintf(stderr, "\x1B[1;32m[SUMMARY]\x1B[0m QPS SERIES %s, SPEED %gx, 延迟从预期发送时间开始计算\n", async_args->qps_series, async_args->replay_speed);
+        }
+    }
+    else if (async_args->rate > 0)
+    {
+        fprintf(stderr, "\x1B[1;32m[SUMMARY]\x1B[0m TARGET QPS %.f, 延迟从预期发送时间开始计算\n", async_args->rate);
+    }
+    if (async_args->replay)
+    {
+        const struct hist *lag = res.replay_lag;
+        fprintf(stderr, "\x1B[1;32m[REPLAY]\x1B[0m %s, FRAMES %" PRIu64 "/%" PRIu64 ", SPAN %.2fs, SPEED %gx, CONN %d -> %d, 延迟从预期发送时间开始计算\n",
+                async_args->replay_path, res.replay_sent, replay_frame_n(async_args->replay), replay_span_us(async_args->replay) / 1e6,
+                async_args->replay_speed, replay_conn_n(async_args->replay), res.conn_n);
+        fprintf(stderr, "\x1B[1;32m[REPLAY]\x1B[0m LAG AVG %.2fms, P50 %.2fms, P99 %.2fms, P99.9 %.2fms, MAX %.2fms\n",
+                hist_mean(lag) / 1000.0, hist_percentile(lag, 50) / 1000.0, hist_percentile(lag, 99) / 1000.0,
+                hist_percentile(lag, 99.9) / 1000.0, hist_max(lag) / 1000.0);
+    }
+    if (async_args->record)
+    {
+        fprintf(stderr, "\x1B[1;%dm[RECORD]\x1B[0m %s, FRAMES %" PRIu64 ", BYTES %" PRIu64 "%s\n", capture_ok ? 32 : 31,
+                async_args->record, capture_n, capture_sz, capture_ok ? "" : ", 写入失败, 录制不完整");
+    }
+    if (async_args->hist_out)
+    {
+        bench_dump_hist(stats->lat, async_args->hist_out);
+    }
+    if (async_args->json_out)
+    {
+        bench_dump_json(async_args->json_out, args, async_args, stats, res.tstats, res.mstats, res.errors, res.started_n, res.conn_n, &res.start, &res.end, elapsed_sec,
+                        async_args->replay ? res.replay_lag : NULL);
+    }
+
+    bool ok = res.started_n == res.thread_n;
+    bench_result_destroy(&res, args);
+    return ok;
+}
+
+// 最大吞吐搜索中的一档
+struct bench_step
+{
+    double level; /* 并发 (-c) 或目标 qps (-R) */
+    double qps;
+    uint64_t lat_us; /* SLO 分位的成功请求延迟 */
+    double err_pct;
+    int64_t done_n;
+    bool pass;
+};
+
+// 连接出错与无法解码的请求没有计入 done_n, 同样算作失败
+static void bench_step_eval(const struct dubbo_async_args *async_args, const struct bench_result *res, struct bench_step *step)
+{
+    const struct bench_stats *stats = &res->stats;
+    int64_t fail_n = stats->done_n - stats->ok_n + stats->outcome_n[OUTCOME_CONN_ERROR] + stats->outcome_n[OUTCOME_DECODE_ERROR];
+    int64_t total_n = stats->ok_n + fail_n;
+    step->done_n = stats->done_n;
+    step->qps = res->elapsed_sec < 0.001 ? 0 : stats->done_n / res->elapsed_sec;
+    step->lat_us = hist_percentile(stats->lat, async_args->slo_pct);
+    step->err_pct = total_n ? 100.0 * fail_n / total_n : 0;
+    step->pass = stats->ok_n > 0 &&
+                 step->lat_us <= async_args->slo_lat_ms * 1000 &&
+                 step->err_pct <= async_args->slo_err_pct;
+}
+
+static void bench_print_step(const struct dubbo_async_args *async_args, const char *tag, int no, const struct bench_step *step)
+{
+    bool conc = async_args->search == BENCH_SEARCH_CONC;
+    fprintf(stderr, "\x1B[1;32m[%s]\x1B[0m #%-2d %s %-8.f QPS %-8.f P%g %8.2fms, ERR %6.2f%%, %s\n",
+            tag, no, conc ? "C" : "R", step->level, step->qps, async_args->slo_pct, step->lat_us / 1000.0, step->err_pct,
+            step->pass ? "\x1B[1;32mPASS\x1B[0m" : "\x1B[1;31mFAIL\x1B[0m");
+}
+
+static int bench_step_cmp(const void *a, const void *b)
+{
+    double la = ((const struct bench_step *)a)->level;
+    double lb = ((const struct bench_step *)b)->level;
+    return la < lb ? -1 : la > lb;
+}
+
+static void bench_dump_search(const char *path, const struct dubbo_async_args *async_args, const struct bench_step *steps, int step_n, int knee)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "search", async_args->search == BENCH_SEARCH_CONC ? "concurrency" : "rate");
+    cJSON *slo = cJSON_CreateObject();
+    cJSON_AddNumberToObject(slo, "percentile", async_args->slo_pct);
+    cJSON_AddNumberToObject(slo, "latency_ms", async_args->slo_lat_ms);
+    cJSON_AddNumberToObject(slo, "error_pct", async_args->slo_err_pct);
+    cJSON_AddItemToObject(root, "slo", slo);
+    cJSON_AddNumberToObject(root, "duration_ms", async_args->duration_ms);
+    cJSON_AddNumberToObject(root, "warmup_ms", async_args->warmup_ms);
+
+    cJSON *jsteps = cJSON_CreateArray();
+    for (int i = 0; i < step_n; i++)
+    {
+        cJSON *s = cJSON_CreateObject();
+        cJSON_AddNumberToObject(s, "level", steps[i].level);
+        cJSON_AddNumberToObject(s, "total", steps[i].done_n);
+        cJSON_AddNumberToObject(s, "qps", steps[i].qps);
+        cJSON_AddNumberToObject(s, "latency_ms", steps[i].lat_us / 1000.0);
+        cJSON_AddNumberToObject(s, "error_pct", steps[i].err_pct);
+        cJSON_AddBoolToObject(s, "pass", steps[i].pass);
+        cJSON_AddItemToArray(jsteps, s);
+    }
+    cJSON_AddItemToObject(root, "steps", jsteps);
+    if (knee >= 0)
+    {
+        cJSON_AddItemReferenceToObject(root, "knee", cJSON_GetArrayItem(jsteps, knee));
+    }
+    else
+    {
+        cJSON_AddNullToObject(root, "knee");
+    }
+
+    char *json = cJSON_Print(root);
+    cJSON_Delete(root);
+
+    FILE *fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (fp == NULL)
+    {
+        LOG_ERROR("打开 %s 失败: %s", path, strerror(errno));
+    }
+    else
+    {
+        fprintf(fp, "%s\n", json);
+        if (fp != stdout)
+        {
+            fclose(fp);
+        }
+    }
+    free(json);
+}
+
+// 先从 lo 起逐档翻倍直到不满足 SLO 或到达 hi, 再在最高通过档与最低失败档之间二分
+bool dubbo_bench_search(struct dubbo_args *args, struct dubbo_async_args *async_args)
+{
+    bool reporter_ok;
+    struct reporter *reporter = bench_reporter_create(async_args, &reporter_ok);
+    if (!reporter_ok)
     {
         return false;
     }
-    return cli_start(cli);
+
+    bool conc = async_args->search == BENCH_SEARCH_CONC;
+    struct dubbo_async_args step_args = *async_args;
+    step_args.hist_out = NULL;
+    step_args.json_out = NULL;
+
+    fprintf(stderr, "\x1B[1;32m[SEARCH]\x1B[0m %s %g ~ %g, SLO P%g <= %.2fms, ERR <= %.2f%%, 每档 %.2fs\n",
+            conc ? "CONCURRENCY" : "TARGET QPS", async_args->search_lo, async_args->search_hi,
+            async_args->slo_pct, async_args->slo_lat_ms, async_args->slo_err_pct, async_args->duration_ms / 1000.0);
+
+    struct bench_step steps[BENCH_SEARCH_MAX_STEPS];
+    int step_n = 0;
+    double pass = 0; /* 最高通过档, 0 为没有 */
+    double fail = 0; /* 最低失败档, 0 为没有 */
+    double level = async_args->search_lo;
+    bool ok = true;
+    while (step_n < BENCH_SEARCH_MAX_STEPS)
+    {
+        if (conc)
+        {
+            step_args.pipe_n = (int)level;
+        }
+        else
+        {
+            step_args.rate = level;
+        }
+
+        struct bench_result res;
+        bench_result_init(&res, args);
+        if (!bench_run(args, &step_args, reporter, NULL, &res))
+        {
+            bench_result_destroy(&res, args);
+            ok = false;
+            break;
+        }
+        ok = res.started_n == res.thread_n;
+        struct bench_step *step = &steps[step_n++];
+        step->level = level;
+        bench_step_eval(async_args, &res, step);
+        bench_result_destroy(&res, args);
+        bench_print_step(async_args, "STEP", step_n, step);
+        if (!ok || stop_signal_raised())
+        {
+            break;
+        }
+
+        if (step->pass)
+        {
+            pass = level;
+        }
+        else if (fail == 0 || level < fail)
+        {
+            fail = level;
+        }
+
+        if (fail == 0)
+        {
+            if (level >= async_args->search_hi)
+            {
+                break;
+            }
+            level = level * 2 < async_args->search_hi ? level * 2 : async_args->search_hi;
+        }
+        else if (pass == 0)
+        {
+            // 最低档已不满足 SLO
+            break;
+        }
+        else if (conc ? fail - pass <= 1 : fail - pass <= pass * BENCH_SEARCH_PRECISION)
+        {
+            break;
+        }
+        else
+        {
+            level = conc ? (int)((pass + fail) / 2) : (pass + fail) / 2;
+        }
+    }
+
+    if (reporter)
+    {
+        reporter_release(reporter);
+    }
+
+    // 拐点取满足 SLO 的各档中实际吞吐最高的一档
+    qsort(steps, step_n, sizeof(steps[0]), bench_step_cmp);
+    int knee = -1;
+    for (int i = 0; i < step_n; i++)
+    {
+        bench_print_step(async_args, "SEARCH", i + 1, &steps[i]);
+        if (steps[i].pass && (knee < 0 || steps[i].qps > steps[knee].qps))
+        {
+            knee = i;
+        }
+    }
+    if (knee >= 0)
+    {
+        fprintf(stderr, "\x1B[1;32m[KNEE]\x1B[0m %s %.f, QPS %.f, P%g %.2fms, ERR %.2f%%\n",
+                conc ? "C" : "R", steps[knee].level, steps[knee].qps, async_args->slo_pct, steps[knee].lat_us / 1000.0, steps[knee].err_pct);
+    }
+    else
+    {
+        fprintf(stderr, "\x1B[1;31m[KNEE]\x1B[0m 没有满足 SLO 的档位\n");
+    }
+    if (async_args->json_out)
+    {
+        bench_dump_search(async_args->json_out, async_args, steps, step_n, knee);
+    }
+    return ok;
 }
 
 bool dubbo_invoke_sync(struct dubbo_args *args)
@@ -4,10 +4,37 @@
 #include <stdbool.h>
 #include <sys/time.h>
 
-struct dubbo_args
+#include "report.h"
+#include "balance.h"
+#include "profile.h"
+#include "replay.h"
+
+// 压测目标 provider
+struct dubbo_target
 {
     char *host;
     char *port;
+    int weight;
+};
+
+// 压测方法, 多个方法按权重混合
+struct dubbo_method
+{
+    char *service;
+    char *method;
+    char *args;   /* JSON */
+    char *attach; /* JSON */
+    double weight;
+};
+
+struct dubbo_args
+{
+    char *host; /* 同步调用使用第一个目标 */
+    char *port;
+    struct dubbo_target *targets;
+    int target_n;
+    struct dubbo_method *methods; /* 压测使用, service/method/args/attach 为第一个方法 */
+    int method_n;
     char *service;
     char *method;
     char *args;   /* JSON */
@@ -15,15 +42,60 @@ struct dubbo_args
     struct timeval timeout;
 };
 
+// SLO 最大吞吐搜索调节的负载维度
+enum bench_search
+{
+    BENCH_SEARCH_NONE,
+    BENCH_SEARCH_CONC, /* 单连接 pipeline 深度 -c */
+    BENCH_SEARCH_RATE, /* 开环目标 qps -R */
+};
+
 struct dubbo_async_args
 {
-    struct aeEventLoop *el;
-    int pipe_n;
-    int req_n;
+    int thread_n; /* 线程数, 每个线程一个 event loop */
+    int conn_n;   /* 每个 provider 的连接数, 均分到各线程 */
+    int pipe_n;   /* 单连接 pipeline 深度, 闭环模式总并发为 pipe_n * conn_n */
+    int req_n;    /* 请求总数, 0 则只按 duration 结束 */
+    long duration_ms; /* 统计窗口时长, 0 则只按 req_n 结束 */
+    long warmup_ms;   /* 所有连接首次建连有结果后的预热时长, 期间完成的请求不计入统计 */
+    double rate; /* 开环定速模式目标 qps, 0 为闭环模式 */
+    enum balance balance; /* 多个 provider 之间的负载均衡策略 */
+    long req_timeout_ms; /* 单个请求超时, 0 则同连接超时 */
+    long heartbeat_ms;   /* 空闲连接心跳间隔, 0 则不发送; 总是应答 provider 的心跳 */
+    long ping_interval_ms; /* 心跳探测间隔, 非 0 则只探测 provider RTT 不压测 */
+    char *hist_out; /* 延迟分布输出文件, "-" 为标准输出 */
+    long report_interval_ms; /* 区间统计输出间隔, 0 则不输出 */
+    char *report_out;        /* 区间统计输出文件, "-" 为标准错误 */
+    enum report_fmt report_fmt;
+    char *json_out; /* JSON 格式的完整压测结果, "-" 为标准输出 */
+    char *dataset;        /* 参数数据集, CSV 或 JSONL, 参数中 {{$N}} {{$name}} 逐个请求替换 */
+    bool dataset_shuffle; /* 按块打乱读取顺序 */
+    bool dataset_wrap;    /* 读完后从头循环, 否则读完即结束压测; 同样适用于语料 */
+    char *corpus;         /* --compile-corpus 生成的预编码语料, 代替参数编码 */
+    uint64_t seed;        /* 参数模板中分布生成器的随机种子, 相同种子结果可复现 */
+    struct profile *profile;  /* 负载曲线, 代替固定的 -R 或 -c */
+    char *qps_series;         /* 生成负载曲线的 "秒,qps" 序列文件 */
+    char *record;             /* 流量录制文件, 记录收发的原始帧 */
+    char *replay_path;        /* 回放的录制文件 */
+    struct replay *replay;    /* 按原始时间间隔回放录制的请求帧, 代替 -m -a 与 -R */
+    double replay_speed;      /* 回放倍速, 原始间隔除以该值; 同样压缩 QPS 序列的时间 */
+    enum bench_search search; /* 最大吞吐搜索, 每档各按 -w -d 压测一轮 */
+    double search_lo;         /* 搜索区间 [lo, hi] */
+    double search_hi;
+    double slo_pct;     /* SLO 延迟分位, 如 99 */
+    double slo_lat_ms;  /* 该分位延迟上限 */
+    double slo_err_pct; /* 失败率上限 (%) */
     bool verbos;
 };
 
 bool dubbo_invoke_sync(struct dubbo_args *);
+// 阻塞直到所有压测线程结束
 bool dubbo_bench_async(struct dubbo_args *, struct dubbo_async_args *);
+// 在 [search_lo, search_hi] 内逐档加压, 找出满足 SLO 的最高吞吐, 输出每档结果与拐点
+bool dubbo_bench_search(struct dubbo_args *, struct dubbo_async_args *);
+// 数据集每行编码为完整的请求帧写入语料文件, -n 限制帧数
+bool dubbo_compile_corpus(struct dubbo_args *, struct dubbo_async_args *, const char *path);
+// 按间隔向每个 provider 发送心跳事件, 输出 RTT 分布/丢失/抖动, 直到 -n 次探测完成、-d 到期或中断
+bool dubbo_ping(struct dubbo_args *, struct dubbo_async_args *);
 
 #endif
\ No newline at end of file
@@ -15,7 +15,8 @@
 
 #define DUBBO_BUF_LEN 8192
 #define DUBBO_MAX_PKT_SZ (1024 * 1024 * 4)
-#define DUBBO_HDR_LEN 16
+#define DUBBO_HDR_REQID_OFFSET 4
+#define DUBBO_HDR_BODY_SZ_OFFSET 12
 #define DUBBO_MAGIC 0xdabb
 #define DUBBO_VER "3.1.0-RELEASE"
 
@@ -52,16 +53,6 @@ public interface GenericService {
 
 #define DUBBO_SERI_MASK 0x1f
 
-#define DUBBO_RES_T_OK 20
-#define DUBBO_RES_T_CLIENT_TIMEOUT 30
-#define DUBBO_RES_T_SERVER_TIMEOUT 31
-#define DUBBO_RES_T_BAD_REQUEST 40
-#define DUBBO_RES_T_BAD_RESPONSE 50
-#define DUBBO_RES_T_SERVICE_NOT_FOUND 60
-#define DUBBO_RES_T_SERVICE_ERROR 70
-#define DUBBO_RES_T_SERVER_ERROR 80
-#define DUBBO_RES_T_CLIENT_ERROR 90
-
 struct dubbo_req
 {
     int64_t reqid;
@@ -79,6 +70,13 @@ struct dubbo_req
     size_t data_sz;
 };
 
+// 参数可变的请求: JSON 参数之前的 body 预先编码
+struct dubbo_req_tpl
+{
+    struct buffer *prefix;
+    struct buffer *suffix; /* JSON 参数之后的 attach map */
+};
+
 struct dubbo_hdr
 {
     int8_t flag;
@@ -114,14 +112,31 @@ static char *get_res_status_desc(int8_t status)
     }
 }
 
+// reqid 按线程分段递增, 多线程压测时互不冲突
+static __thread int64_t reqid_begin = 1;
+static __thread int64_t reqid_end = 0x7fffffffffffffff;
+static __thread int64_t reqid = 0;
+
+void dubbo_reqid_range(int64_t begin, int64_t end)
+{
+    assert(begin > 0 && begin < end);
+    reqid_begin = begin;
+    reqid_end = end;
+    reqid = begin - 1;
+}
+
 static int64_t next_reqid()
 {
-    static int64_t id = 0;
-    if (++id == 0x7fffffffffffffff)
+    if (++reqid >= reqid_end)
     {
-        id = 1;
+        reqid = reqid_begin;
     }
-    return id;
+    return reqid;
+}
+
+int64_t dubbo_next_reqid()
+{
+    return next_reqid();
 }
 
 static char *rebuild_json_args(const char *json_str)
@@ -152,11 +167,83 @@ static char *rebuild_json_args(const char *json_str)
     return ascii_s;
 }
 
-// fixme
-// static char *rebuild_json_attach(char *json_str)
-// {
-//     return NULL;
-// }
+// hessian 字符串长度为 UTF-16 字符数, 不能直接用字节数 (同 hs_encode_string) 编码非 ASCII 文本
+// 只支持 BMP 字符 (UTF-8 不超过 3 字节) 与单个分块
+static bool append_hs_utf8_str(struct buffer *buf, const char *s)
+{
+    size_t sz = strlen(s);
+    size_t len = 0;
+    for (size_t i = 0; i < sz; i++)
+    {
+        uint8_t c = (uint8_t)s[i];
+        if (c >= 0xF0)
+        {
+            return false;
+        }
+        if ((c & 0xC0) != 0x80)
+        {
+            len++;
+        }
+    }
+    if (len > 0xffff)
+    {
+        return false;
+    }
+
+    if (len <= 31)
+    {
+        buf_appendInt8(buf, (int8_t)len);
+    }
+    else if (len <= 1023)
+    {
+        buf_appendInt8(buf, (int8_t)(48 + (len >> 8)));
+        buf_appendInt8(buf, (int8_t)len);
+    }
+    else
+    {
+        buf_appendInt8(buf, 'S');
+        buf_appendInt16(buf, (int16_t)len);
+    }
+    buf_append(buf, s, sz);
+    return true;
+}
+
+// attach JSON 对象编码为 hessian 无类型 map ('H' k v ... 'Z'), Dubbo 的 attachment 值为字符串, 非字符串值取其 JSON 文本
+// 未指定或空对象时写 NULL
+static bool encode_req_attach(struct buffer *buf, const char *json_attach)
+{
+    cJSON *root = json_attach ? cJSON_Parse(json_attach) : NULL;
+    if (json_attach && (root == NULL || !cJSON_IsObject(root)))
+    {
+        LOG_ERROR("attach must be json object: %s", json_attach);
+        cJSON_Delete(root);
+        return false;
+    }
+    if (root == NULL || root->child == NULL)
+    {
+        cJSON_Delete(root);
+        buf_appendInt8(buf, 'N');
+        return true;
+    }
+
+    bool ok = true;
+    buf_appendInt8(buf, 'H');
+    cJSON *item;
+    cJSON_ArrayForEach(item, root)
+    {
+        char *val = cJSON_IsString(item) ? NULL : cJSON_PrintUnformatted(item);
+        ok = append_hs_utf8_str(buf, item->string) && append_hs_utf8_str(buf, val ? val : item->valuestring);
+        free(val);
+        if (!ok)
+        {
+            LOG_ERROR("unsupported attach %s, only BMP characters and less than 65536 chars are supported", item->string);
+            break;
+        }
+    }
+    buf_appendInt8(buf, 'Z');
+    cJSON_Delete(root);
+    return ok;
+}
 
 static bool encode_req_hdr(struct buffer *buf, const struct dubbo_hdr *hdr)
 {
@@ -204,6 +291,11 @@ static bool decode_res_hdr(struct buffer *buf, struct dubbo_hdr *hdr)
         // decode response
         return true;
     }
+    else if (hdr->flag & DUBBO_FLAG_EVT)
+    {
+        // 对端发来的事件请求, 如 provider 的心跳, 由调用方应答
+        return true;
+    }
     else
     {
         // decode request
@@ -222,17 +314,27 @@ static bool decode_res_hdr(struct buffer *buf, struct dubbo_hdr *hdr)
         buf_has_written(buf, n);                                         \
     }
 
-static bool encode_req_data(struct buffer *buf, const struct dubbo_req *req)
+// JSON 参数之前的部分
+static bool encode_req_prefix(struct buffer *buf, const char *service, const char *method)
 {
     write_hs_str(buf, DUBBO_VER);
-    write_hs_str(buf, req->service);
+    write_hs_str(buf, service);
     write_hs_str(buf, DUBBO_GENERIC_METHOD_VER);
     write_hs_str(buf, DUBBO_GENERIC_METHOD_NAME);
     write_hs_str(buf, DUBBO_GENERIC_METHOD_PARA_TYPES);
 
     // args
-    write_hs_str(buf, req->argv[DUBBO_GENERIC_METHOD_ARGV_METHOD_IDX]);
+    write_hs_str(buf, method);
     buf_has_written(buf, hs_encode_null((uint8_t *)buf_beginWrite(buf))); // 方法类型提示 NULL, 不支持重载方法
+    return true;
+}
+
+static bool encode_req_data(struct buffer *buf, const struct dubbo_req *req)
+{
+    if (!encode_req_prefix(buf, req->service, req->argv[DUBBO_GENERIC_METHOD_ARGV_METHOD_IDX]))
+    {
+        return false;
+    }
 #ifdef DUBBO_BYTE_CODEC
     const char *args = req->argv[DUBBO_GENERIC_METHOD_ARGV_ARGS_IDX];
     hs_encode_binary(args, strlen(args), buf);
@@ -240,10 +342,7 @@ static bool encode_req_data(struct buffer *buf, const struct dubbo_req *req)
     write_hs_str(buf, req->argv[DUBBO_GENERIC_METHOD_ARGV_ARGS_IDX]);
 #endif
 
-    // TODO: fixme :  attach NULL
-    buf_has_written(buf, hs_encode_null((uint8_t *)buf_beginWrite(buf)));
-
-    return true;
+    return encode_req_attach(buf, req->attach);
 }
 
 #define read_hs_str(buf, out, out_sz)                                                        \
@@ -348,6 +447,16 @@ static bool encode_req(struct buffer *buf, const struct dubbo_req *req)
 static bool decode_res(struct buffer *buf, const struct dubbo_hdr *hdr, struct dubbo_res *res)
 {
     res->is_evt = hdr->flag & DUBBO_FLAG_EVT;
+    res->is_req = hdr->flag & DUBBO_FLAG_REQ;
+    res->is_twoway = hdr->flag & DUBBO_FLAG_TWOWAY;
+    if (res->is_req)
+    {
+        // 事件请求的数据不关心, body 已由调用方跳过
+        res->ok = true;
+        res->desc = strdup("EVENT");
+        return true;
+    }
+    res->status = (uint8_t)hdr->status;
     res->desc = strdup(get_res_status_desc(hdr->status));
 
     if (hdr->status == DUBBO_RES_T_OK)
@@ -401,7 +510,7 @@ struct dubbo_req *dubbo_req_create(const char *service, const char *method, cons
     req->argv[DUBBO_GENERIC_METHOD_ARGV_TYPES_IDX] = NULL;
     req->argv[DUBBO_GENERIC_METHOD_ARGV_ARGS_IDX] = args;
 
-    // fixme 要处理成 hessian map
+    // 编码时转为 hessian map
     if (json_attach)
     {
         req->attach = strdup(json_attach);
@@ -412,17 +521,46 @@ struct dubbo_req *dubbo_req_create(const char *service, const char *method, cons
 
 void dubbo_req_release(struct dubbo_req *req)
 {
-    free(req->argv[DUBBO_GENERIC_METHOD_ARGV_METHOD_IDX]);
-    // free(req->argv[DUBBO_GENERIC_METHOD_ARGV_TYPES_IDX]);
-    free(req->argv[DUBBO_GENERIC_METHOD_ARGV_ARGS_IDX]);
-    free(req->argv);
+    free(req->service);
+    free(req->method);
+    if (req->argv)
+    {
+        free(req->argv[DUBBO_GENERIC_METHOD_ARGV_METHOD_IDX]);
+        // free(req->argv[DUBBO_GENERIC_METHOD_ARGV_TYPES_IDX]);
+        free(req->argv[DUBBO_GENERIC_METHOD_ARGV_ARGS_IDX]);
+        free(req->argv);
+    }
     if (req->attach)
     {
         free(req->attach);
     }
+    free(req->data);
     free(req);
 }
 
+struct dubbo_req *dubbo_heartbeat_create()
+{
+    struct dubbo_req *req = calloc(1, sizeof(*req));
+    assert(req);
+    req->reqid = next_reqid();
+    req->is_twoway = true;
+    req->is_evt = true;
+    // 心跳事件的数据为 hessian null
+    req->data = strdup("N");
+    req->data_sz = 1;
+    return req;
+}
+
+void dubbo_heartbeat_reply(struct buffer *buf, int64_t reqid)
+{
+    buf_appendInt16(buf, (int16_t)DUBBO_MAGIC);
+    buf_appendInt8(buf, (int8_t)DUBBO_FLAG_EVT | (int8_t)DUBBO_HESSIAN2_SERI_ID);
+    buf_appendInt8(buf, DUBBO_RES_T_OK);
+    buf_appendInt64(buf, reqid);
+    buf_appendInt32(buf, 1);
+    buf_appendInt8(buf, 'N');
+}
+
 int64_t dubbo_req_getid(struct dubbo_req *req)
 {
     return req->reqid;
@@ -479,6 +617,153 @@ struct dubbo_res *dubbo_decode(struct buffer *buf)
     }
 }
 
+struct dubbo_req_tpl *dubbo_req_tpl_create(const char *service, const char *method, const char *json_attach)
+{
+    struct dubbo_req_tpl *tpl = calloc(1, sizeof(*tpl));
+    assert(tpl);
+    tpl->prefix = buf_create(DUBBO_BUF_LEN);
+    tpl->suffix = buf_create(DUBBO_BUF_LEN);
+    if (!encode_req_prefix(tpl->prefix, service, method) || !encode_req_attach(tpl->suffix, json_attach))
+    {
+        dubbo_req_tpl_release(tpl);
+        return NULL;
+    }
+    return tpl;
+}
+
+void dubbo_req_tpl_release(struct dubbo_req_tpl *tpl)
+{
+    buf_release(tpl->prefix);
+    buf_release(tpl->suffix);
+    free(tpl);
+}
+
+void dubbo_req_tpl_encode(const struct dubbo_req_tpl *tpl, int64_t reqid, const char *json_args, size_t sz, struct buffer *buf)
+{
+    size_t begin = buf_readable(buf);
+    buf_appendInt16(buf, (int16_t)DUBBO_MAGIC);
+    buf_appendInt8(buf, (int8_t)DUBBO_FLAG_REQ | (int8_t)DUBBO_FLAG_TWOWAY | (int8_t)DUBBO_HESSIAN2_SERI_ID);
+    buf_appendInt8(buf, 0);
+    buf_appendInt64(buf, reqid);
+    buf_appendInt32(buf, 0);
+
+    buf_append(buf, buf_peek(tpl->prefix), buf_readable(tpl->prefix));
+#ifdef DUBBO_BYTE_CODEC
+    hs_encode_binary(json_args, sz, buf);
+#else
+    buf_ensureWritable(buf, sz * 3 + 8);
+    buf_has_written(buf, hs_encode_string(json_args, (uint8_t *)buf_beginWrite(buf)));
+#endif
+    buf_append(buf, buf_peek(tpl->suffix), buf_readable(tpl->suffix));
+
+    // body 长度在编码完成后回填
+    char *frame = (char *)buf_peek(buf) + begin;
+    int32_t be32 = htobe32((int32_t)(buf_readable(buf) - begin - DUBBO_HDR_LEN));
+    memcpy(frame + DUBBO_HDR_BODY_SZ_OFFSET, &be32, sizeof(be32));
+}
+
+bool dubbo_decode_view(struct buffer *buf, struct dubbo_res_view *view)
+{
+    struct dubbo_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+
+    if (!decode_res_hdr(buf, &hdr))
+    {
+        LOG_ERROR("failed to decode dubbo response");
+        return false;
+    }
+    if (buf_readable(buf) < (size_t)hdr.body_sz)
+    {
+        LOG_ERROR("incomplete dubbo response body");
+        return false;
+    }
+
+    const uint8_t *body = (const uint8_t *)buf_peek(buf);
+    size_t body_sz = hdr.body_sz;
+    memset(view, 0, sizeof(*view));
+    view->reqid = hdr.reqid;
+    view->is_evt = hdr.flag & DUBBO_FLAG_EVT;
+    view->is_req = hdr.flag & DUBBO_FLAG_REQ;
+    view->is_twoway = hdr.flag & DUBBO_FLAG_TWOWAY;
+    view->status = (uint8_t)hdr.status;
+    view->type = -1;
+
+    bool ok = true;
+    if (view->is_req)
+    {
+        // 事件请求的状态码无意义, 数据不关心
+    }
+    else if (view->status != DUBBO_RES_T_OK)
+    {
+        ok = hs_view_string(body, body_sz, &view->data, &view->data_sz, &view->payload_sz);
+    }
+    else if (!view->is_evt)
+    {
+        uint8_t flag = body_sz ? body[0] : 0;
+        if (flag < 0x80 || flag > 0xbf)
+        {
+            LOG_ERROR("invalid response type %d (raw)", flag);
+            return false;
+        }
+        view->type = flag - 0x90;
+        switch (view->type)
+        {
+        case DUBBO_RES_NULL:
+            break;
+        case DUBBO_RES_EX:
+            ok = hs_view_string(body + 1, body_sz - 1, &view->data, &view->data_sz, &view->payload_sz);
+            break;
+        case DUBBO_RES_VAL:
+#ifdef DUBBO_BYTE_CODEC
+            ok = hs_view_binary(body + 1, body_sz - 1, &view->data, &view->data_sz, &view->payload_sz);
+#else
+            ok = hs_view_string(body + 1, body_sz - 1, &view->data, &view->data_sz, &view->payload_sz);
+#endif
+            break;
+        default:
+            LOG_ERROR("unknown result flag, expect '0' '1' '2', get %d", view->type);
+            return false;
+        }
+    }
+
+    if (!ok)
+    {
+        LOG_ERROR("failed to decode response data");
+        return false;
+    }
+    buf_retrieve(buf, body_sz);
+    return true;
+}
+
+void dubbo_frame_set_reqid(char *frame, int64_t reqid)
+{
+    int64_t be64 = htobe64(reqid);
+    memcpy(frame + DUBBO_HDR_REQID_OFFSET, &be64, sizeof(be64));
+}
+
+int64_t dubbo_frame_get_reqid(const char *frame)
+{
+    int64_t be64;
+    memcpy(&be64, frame + DUBBO_HDR_REQID_OFFSET, sizeof(be64));
+    return be64toh(be64);
+}
+
+bool dubbo_frame_is_call(const char *frame, size_t len)
+{
+    if (len < DUBBO_HDR_LEN || (uint8_t)frame[0] != (DUBBO_MAGIC >> 8) || (uint8_t)frame[1] != (DUBBO_MAGIC & 0xff))
+    {
+        return false;
+    }
+    int32_t body_sz;
+    memcpy(&body_sz, frame + DUBBO_HDR_BODY_SZ_OFFSET, sizeof(body_sz));
+    if ((size_t)be32toh(body_sz) != len - DUBBO_HDR_LEN)
+    {
+        return false;
+    }
+    uint8_t flag = (uint8_t)frame[2];
+    return (flag & DUBBO_FLAG_REQ) && (flag & DUBBO_FLAG_TWOWAY) && !(flag & DUBBO_FLAG_EVT);
+}
+
 bool is_dubbo_pkt(const struct buffer *buf)
 {
     return buf_readable(buf) >= DUBBO_HDR_LEN && (uint16_t)buf_peekInt16(buf) == DUBBO_MAGIC;
@@ -45,9 +45,22 @@ public interface GenericService {
 }
 */
 
+#define DUBBO_HDR_LEN 16
+
 /* binary 泛化实现 */
 #define DUBBO_BYTE_CODEC
 
+// 响应 header 中的状态码
+#define DUBBO_RES_T_OK 20
+#define DUBBO_RES_T_CLIENT_TIMEOUT 30
+#define DUBBO_RES_T_SERVER_TIMEOUT 31
+#define DUBBO_RES_T_BAD_REQUEST 40
+#define DUBBO_RES_T_BAD_RESPONSE 50
+#define DUBBO_RES_T_SERVICE_NOT_FOUND 60
+#define DUBBO_RES_T_SERVICE_ERROR 70
+#define DUBBO_RES_T_SERVER_ERROR 80
+#define DUBBO_RES_T_CLIENT_ERROR 90
+
 #define DUBBO_RES_EX 0
 #define DUBBO_RES_VAL 1
 #define DUBBO_RES_NULL 2
@@ -64,7 +77,10 @@ struct dubbo_res
 {
     int64_t reqid;
     bool is_evt;
-    bool ok;
+    bool is_req;    /* 对端发来的事件请求 (如 provider 心跳), 其余字段无意义 */
+    bool is_twoway; /* 事件请求需要应答 */
+    bool ok; /* 状态码为 OK, 业务异常 (type 为 ex) 时同样为 true */
+    int status;
     dubbo_res_type type;
     char *desc;
     char *data;
@@ -73,13 +89,50 @@ struct dubbo_res
     size_t attach_sz;
 };
 
+// 轻量解码结果, 不分配内存; data 指向接收缓冲区, 仅在缓冲区下次写入或回收前有效
+struct dubbo_res_view
+{
+    int64_t reqid;
+    bool is_evt;
+    bool is_req;    /* 同 dubbo_res */
+    bool is_twoway;
+    int status;
+    int type;          /* 状态码非 OK 或事件时为 -1 */
+    const char *data;  /* 结果/异常信息首个分块 */
+    size_t data_sz;
+    size_t payload_sz; /* 结果/异常信息总字节数 */
+};
+
 struct dubbo_req *dubbo_req_create(const char *service, const char *method, const char *json_args, const char *json_attach);
 void dubbo_req_release(struct dubbo_req *);
 int64_t dubbo_req_getid(struct dubbo_req *);
+// 心跳事件请求 (双向, 数据为 null), 用 dubbo_encode 编码
+struct dubbo_req *dubbo_heartbeat_create();
+// 向 buf 追加对端心跳请求的应答帧
+void dubbo_heartbeat_reply(struct buffer *buf, int64_t reqid);
+// 设置当前线程 reqid 取值区间 [begin, end)
+void dubbo_reqid_range(int64_t begin, int64_t end);
+int64_t dubbo_next_reqid();
 void dubbo_res_release(struct dubbo_res *);
 
 struct buffer *dubbo_encode(const struct dubbo_req *);
+// 除响应外也接受对端的事件请求, 以 is_req 区分, 普通请求视为错误
 struct dubbo_res *dubbo_decode(struct buffer *);
+// 校验并消费缓冲区中一个完整的响应帧, 只提取 reqid/状态码/结果类型/载荷位置, 不拷贝; 事件请求同 dubbo_decode
+bool dubbo_decode_view(struct buffer *, struct dubbo_res_view *);
+
+// 改写已编码请求帧 header 中的 reqid, 用于复用预编码的请求帧
+void dubbo_frame_set_reqid(char *frame, int64_t reqid);
+int64_t dubbo_frame_get_reqid(const char *frame);
+// 完整帧是否为需要响应的普通请求 (双向且非心跳等事件), 长度不足 header、magic 不符或 body 长度与 len 不一致返回 false
+bool dubbo_frame_is_call(const char *frame, size_t len);
+
+// 参数逐个请求变化时使用: 服务名/方法名部分只编码一次, 每次只编码 header 与 JSON 参数
+struct dubbo_req_tpl;
+struct dubbo_req_tpl *dubbo_req_tpl_create(const char *service, const char *method, const char *json_attach);
+void dubbo_req_tpl_release(struct dubbo_req_tpl *);
+// 向 buf 追加一个完整的请求帧, json_args 须为 JSON 数组文本, 不做校验与转码
+void dubbo_req_tpl_encode(const struct dubbo_req_tpl *, int64_t reqid, const char *json_args, size_t sz, struct buffer *buf);
 
 bool is_dubbo_pkt(const struct buffer *);
 
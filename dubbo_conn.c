@@ -0,0 +1,294 @@
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "dubbo_conn.h"
+#include "dubbo_codec.h"
+#include "socket.h"
+#include "log.h"
+
+static volatile sig_atomic_t g_stop;
+
+static void conn_on_connect(struct aeEventLoop *el, int fd, void *ud, int mask);
+static void conn_on_read(struct aeEventLoop *el, int fd, void *ud, int mask);
+static void conn_on_write(struct aeEventLoop *el, int fd, void *ud, int mask);
+
+void conn_init(struct conn *c, struct aeEventLoop *el, const struct conn_ops *ops, void *ud, size_t buf_sz)
+{
+    memset(c, 0, sizeof(*c));
+    c->el = el;
+    c->ops = ops;
+    c->ud = ud;
+    c->fd = -1;
+    c->timerid = AE_NOMORE;
+    c->rcv_buf = buf_create(buf_sz);
+    c->snd_buf = buf_create(buf_sz);
+}
+
+void conn_destroy(struct conn *c)
+{
+    conn_close(c);
+    buf_release(c->rcv_buf);
+    buf_release(c->snd_buf);
+}
+
+static void conn_clear_timer(struct conn *c)
+{
+    if (c->timerid != AE_NOMORE)
+    {
+        aeDeleteTimeEvent(c->el, c->timerid);
+        c->timerid = AE_NOMORE;
+    }
+}
+
+void conn_close(struct conn *c)
+{
+    conn_clear_timer(c);
+    if (c->fd != -1)
+    {
+        aeDeleteFileEvent(c->el, c->fd, AE_READABLE | AE_WRITABLE);
+        close(c->fd);
+        c->fd = -1;
+    }
+    c->connected = false;
+    buf_retrieveAll(c->rcv_buf);
+    buf_retrieveAll(c->snd_buf);
+}
+
+static bool conn_established(struct conn *c)
+{
+    conn_clear_timer(c);
+    if (AE_ERR == aeCreateFileEvent(c->el, c->fd, AE_READABLE, conn_on_read, c))
+    {
+        return false;
+    }
+    c->connected = true;
+    c->last_read_us = c->last_write_us = now_us();
+    c->ops->on_connect(c);
+    return true;
+}
+
+static int conn_on_connect_timeout(struct aeEventLoop *el, long long id, void *ud)
+{
+    UNUSED(el);
+    UNUSED(id);
+    struct conn *c = (struct conn *)ud;
+    c->timerid = AE_NOMORE;
+    c->ops->on_error(c, CONN_ERR_TIMEOUT, 0);
+    return AE_NOMORE;
+}
+
+bool conn_connect(struct conn *c, const union sockaddr_all *addr, long timeout_ms)
+{
+    int fd = socket_create();
+    if (fd < 0)
+    {
+        return false;
+    }
+    c->fd = fd;
+
+    if (socket_connect(fd, addr, sizeof(addr->s)) == 0)
+    {
+        if (!conn_established(c))
+        {
+            conn_close(c);
+            return false;
+        }
+        return true;
+    }
+    if (errno != EINPROGRESS || AE_ERR == aeCreateFileEvent(c->el, fd, AE_WRITABLE, conn_on_connect, c))
+    {
+        conn_close(c);
+        return false;
+    }
+    c->timerid = aeCreateTimeEvent(c->el, timeout_ms, conn_on_connect_timeout, c, NULL);
+    if (AE_ERR == c->timerid)
+    {
+        c->timerid = AE_NOMORE;
+        conn_close(c);
+        return false;
+    }
+    return true;
+}
+
+static void conn_on_connect(struct aeEventLoop *el, int fd, void *ud, int mask)
+{
+    UNUSED(mask);
+    struct conn *c = (struct conn *)ud;
+    // ae 将 err 与 hup 转换成可写事件, 需要检查 SO_ERROR
+    aeDeleteFileEvent(el, fd, AE_WRITABLE);
+    int err = socket_getError(fd);
+    if (err != 0)
+    {
+        c->ops->on_error(c, CONN_ERR_CONNECT, err);
+        return;
+    }
+    if (!conn_established(c))
+    {
+        c->ops->on_error(c, CONN_ERR_CONNECT, errno);
+    }
+}
+
+bool conn_write(struct conn *c)
+{
+    struct buffer *buf = c->snd_buf;
+    while (buf_readable(buf))
+    {
+        ssize_t n = write(c->fd, buf_peek(buf), buf_readable(buf));
+        if (c->io)
+        {
+            c->io->write_n++;
+        }
+        if (n > 0)
+        {
+            buf_retrieve(buf, n);
+            c->last_write_us = now_us();
+            if (c->io)
+            {
+                c->io->bytes_out += n;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN)
+        {
+            return AE_ERR != aeCreateFileEvent(c->el, c->fd, AE_WRITABLE, conn_on_write, c);
+        }
+        return false;
+    }
+    aeDeleteFileEvent(c->el, c->fd, AE_WRITABLE);
+    return true;
+}
+
+static void conn_on_write(struct aeEventLoop *el, int fd, void *ud, int mask)
+{
+    UNUSED(el);
+    UNUSED(fd);
+    UNUSED(mask);
+    struct conn *c = (struct conn *)ud;
+    if (!conn_write(c))
+    {
+        c->ops->on_error(c, CONN_ERR_WRITE, errno);
+    }
+}
+
+static void conn_on_read(struct aeEventLoop *el, int fd, void *ud, int mask)
+{
+    UNUSED(el);
+    UNUSED(mask);
+    struct conn *c = (struct conn *)ud;
+
+    for (;;)
+    {
+        int errno_ = 0;
+        ssize_t n = buf_readFd(c->rcv_buf, fd, &errno_);
+        if (n < 0)
+        {
+            if (errno_ == EINTR)
+            {
+                continue;
+            }
+            if (errno_ != EAGAIN)
+            {
+                c->ops->on_error(c, CONN_ERR_READ, errno_);
+                return;
+            }
+        }
+        else if (n == 0)
+        {
+            c->ops->on_error(c, CONN_ERR_CLOSED, 0);
+            return;
+        }
+        else
+        {
+            c->last_read_us = now_us();
+            if (c->io)
+            {
+                c->io->bytes_in += n;
+            }
+        }
+        break;
+    }
+
+    // 一次读取可能包含多个帧, 处理缓冲区中所有完整的帧, 不完整的留待下次读取
+    int frame_n = 0;
+    while (buf_readable(c->rcv_buf) >= DUBBO_HDR_LEN)
+    {
+        int remaining = 0;
+        if (!is_completed_dubbo_pkt(c->rcv_buf, &remaining))
+        {
+            c->ops->on_error(c, CONN_ERR_PROTO, 0);
+            return;
+        }
+        if (remaining > 0)
+        {
+            break;
+        }
+        // 缓冲区中有多个帧时 remaining 为负
+        if (!c->ops->on_frame(c, buf_readable(c->rcv_buf) + remaining))
+        {
+            c->ops->on_error(c, CONN_ERR_PROTO, 0);
+            return;
+        }
+        frame_n++;
+    }
+
+    if (frame_n > 0 && c->ops->on_frames)
+    {
+        c->ops->on_frames(c, frame_n);
+    }
+}
+
+const char *conn_strerror(enum conn_err err)
+{
+    switch (err)
+    {
+    case CONN_ERR_CONNECT:
+        return "连接失败";
+    case CONN_ERR_TIMEOUT:
+        return "连接超时";
+    case CONN_ERR_READ:
+        return "读取数据失败";
+    case CONN_ERR_CLOSED:
+        return "服务端断开连接";
+    case CONN_ERR_WRITE:
+        return "发送数据失败";
+    case CONN_ERR_PROTO:
+        return "接收到异常 dubbo 数据包";
+    }
+    return "未知错误";
+}
+
+static void stop_signal_handler(int dummy)
+{
+    UNUSED(dummy);
+    if (g_stop)
+    {
+        // 再次中断则直接退出
+        _exit(1);
+    }
+    g_stop = 1;
+}
+
+void stop_signal_install()
+{
+    g_stop = 0;
+    signal(SIGINT, stop_signal_handler);
+    signal(SIGTERM, stop_signal_handler);
+}
+
+void stop_signal_restore()
+{
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+}
+
+bool stop_signal_raised()
+{
+    return g_stop;
+}
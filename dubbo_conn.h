@@ -0,0 +1,87 @@
+#ifndef DUBBO_CONN_H
+#define DUBBO_CONN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "buffer.h"
+#include "sa.h"
+#include "lib/ae/ae.h"
+
+// 事件循环上的一条 Dubbo 连接: 非阻塞建连与建连超时、发送缓冲、读取并按帧切分
+// 压测连接与心跳探测共用, 帧的处理以及出错后关闭还是重连由上层回调决定
+
+enum conn_err
+{
+    CONN_ERR_CONNECT, /* 建连失败 */
+    CONN_ERR_TIMEOUT, /* 建连超时 */
+    CONN_ERR_READ,    /* 读取失败 */
+    CONN_ERR_CLOSED,  /* 对端断开 */
+    CONN_ERR_WRITE,   /* 可写事件中发送失败 */
+    CONN_ERR_PROTO,   /* 非 dubbo 数据包或帧处理失败 */
+};
+
+struct conn;
+
+struct conn_ops
+{
+    void (*on_connect)(struct conn *);
+    // rcv_buf 头部为一个长度为 len 的完整帧, 须取走整帧; 返回 false 视为协议错误
+    bool (*on_frame)(struct conn *, size_t len);
+    // 一次读取到的帧全部处理完后调用, 没有完整的帧时不调用; 可为 NULL
+    void (*on_frames)(struct conn *, int frame_n);
+    // 出错时连接尚未关闭, 回调中须 conn_close 或关闭后重连; sys_errno 为 0 表示没有对应的系统错误
+    void (*on_error)(struct conn *, enum conn_err err, int sys_errno);
+};
+
+// 读写计数, 可由多条连接共用
+struct conn_io
+{
+    int64_t write_n; /* write 系统调用次数 */
+    int64_t bytes_in;
+    int64_t bytes_out;
+};
+
+struct conn
+{
+    struct aeEventLoop *el;
+    const struct conn_ops *ops;
+    void *ud;
+    struct conn_io *io; /* 可为 NULL */
+
+    int fd;
+    bool connected;
+    long long timerid; /* 建连超时 */
+    struct buffer *rcv_buf;
+    struct buffer *snd_buf;
+    uint64_t last_read_us; /* 空闲检测 */
+    uint64_t last_write_us;
+};
+
+static inline uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void conn_init(struct conn *, struct aeEventLoop *el, const struct conn_ops *ops, void *ud, size_t buf_sz);
+void conn_destroy(struct conn *);
+
+// 立即建立时在返回前回调 on_connect; 返回 false 时已关闭, 不回调 on_error
+bool conn_connect(struct conn *, const union sockaddr_all *addr, long timeout_ms);
+// 关闭 fd, 删除事件与建连定时器, 清空收发缓冲, 不回调
+void conn_close(struct conn *);
+// 写出 snd_buf, 写不完时注册可写事件继续发送; 失败返回 false 并保留 errno, 不回调 on_error
+bool conn_write(struct conn *);
+
+const char *conn_strerror(enum conn_err err);
+
+// SIGINT/SIGTERM 只置停止标志, 由事件循环定时检查; 再次中断直接退出
+void stop_signal_install();
+void stop_signal_restore();
+bool stop_signal_raised();
+
+#endif
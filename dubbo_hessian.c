@@ -501,7 +501,7 @@ void hs_encode_binary(const char *bin, size_t sz, struct buffer *out_buf)
 
 static bool hs_decode_binary_chunk(struct buffer *buf, char **out, size_t *out_sz, size_t *left)
 {
-    int sz = buf_readInt16(buf);
+    int sz = (uint16_t)buf_readInt16(buf);
     if (*left < sz)
     {
         char *new_out = realloc(*out, *out_sz + BIN_CHUNK_MAX + 1);
@@ -588,4 +588,164 @@ bool hs_decode_binary(struct buffer *buf, char **out, size_t *out_sz)
     }
     (*out)[*out_sz] = '\0';
     return true;
-}
\ No newline at end of file
+}
+
+// 跳过 n 个字符, 返回占用字节数, 越界或非法 utf8 返回 -1
+static ssize_t utf8_skip(const uint8_t *src, size_t n, size_t sz)
+{
+    size_t i = 0;
+    while (n--)
+    {
+        if (i >= sz)
+        {
+            return -1;
+        }
+        uint8_t c = src[i];
+        if (c < 0x80)
+        {
+            i += 1;
+        }
+        else if ((c & 0xE0) == 0xC0)
+        {
+            i += 2;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            i += 3;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            i += 4;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    return i > sz ? -1 : (ssize_t)i;
+}
+
+bool hs_view_string(const uint8_t *buf, size_t sz, const char **chunk, size_t *chunk_sz, size_t *total_sz)
+{
+    size_t pos = 0;
+    bool last = false;
+    *chunk = NULL;
+    *chunk_sz = 0;
+    *total_sz = 0;
+
+    while (!last)
+    {
+        if (pos >= sz)
+        {
+            return false;
+        }
+        uint8_t code = buf[pos];
+        size_t n;
+        if (code <= 0x1f)
+        {
+            n = code;
+            pos += 1;
+            last = true;
+        }
+        else if (code >= 0x30 && code <= 0x33)
+        {
+            if (pos + 2 > sz)
+            {
+                return false;
+            }
+            n = (code - 0x30) * 256 + buf[pos + 1];
+            pos += 2;
+            last = true;
+        }
+        else if (code == 0x53 || code == 0x52)
+        {
+            if (pos + 3 > sz)
+            {
+                return false;
+            }
+            n = ((size_t)buf[pos + 1] << 8) | buf[pos + 2];
+            pos += 3;
+            last = code == 0x53;
+        }
+        else
+        {
+            return false;
+        }
+
+        ssize_t bytes = utf8_skip(buf + pos, n, sz - pos);
+        if (bytes < 0)
+        {
+            return false;
+        }
+        if (*chunk == NULL)
+        {
+            *chunk = (const char *)buf + pos;
+            *chunk_sz = bytes;
+        }
+        *total_sz += bytes;
+        pos += bytes;
+    }
+    return true;
+}
+
+bool hs_view_binary(const uint8_t *buf, size_t sz, const char **chunk, size_t *chunk_sz, size_t *total_sz)
+{
+    size_t pos = 0;
+    bool last = false;
+    *chunk = NULL;
+    *chunk_sz = 0;
+    *total_sz = 0;
+
+    while (!last)
+    {
+        if (pos >= sz)
+        {
+            return false;
+        }
+        uint8_t code = buf[pos];
+        size_t n;
+        if (code >= 0x20 && code <= 0x2f)
+        {
+            n = code - 0x20;
+            pos += 1;
+            last = true;
+        }
+        else if (code >= 0x34 && code <= 0x37)
+        {
+            if (pos + 2 > sz)
+            {
+                return false;
+            }
+            n = ((size_t)(code - 0x34) << 8) | buf[pos + 1];
+            pos += 2;
+            last = true;
+        }
+        else if (code == 'B' || code == 0x41)
+        {
+            if (pos + 3 > sz)
+            {
+                return false;
+            }
+            n = ((size_t)buf[pos + 1] << 8) | buf[pos + 2];
+            pos += 3;
+            last = code == 'B';
+        }
+        else
+        {
+            return false;
+        }
+
+        if (n > sz - pos)
+        {
+            return false;
+        }
+        if (*chunk == NULL)
+        {
+            *chunk = (const char *)buf + pos;
+            *chunk_sz = n;
+        }
+        *total_sz += n;
+        pos += n;
+    }
+    return true;
+}
@@ -21,4 +21,8 @@ bool hs_decode_string(const uint8_t *buf, size_t sz, char **out, size_t *out_sz)
 
 void hs_encode_binary(const char *bin, size_t sz, struct buffer *out_buf);
 bool hs_decode_binary(struct buffer *buf, char **out, size_t *out_sz);
+
+// 只校验不拷贝: chunk 指向首个分块数据 (可能不是完整的值), total_sz 为各分块字节数之和
+bool hs_view_string(const uint8_t *buf, size_t sz, const char **chunk, size_t *chunk_sz, size_t *total_sz);
+bool hs_view_binary(const uint8_t *buf, size_t sz, const char **chunk, size_t *chunk_sz, size_t *total_sz);
 #endif
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <inttypes.h>
+
+#include "dubbo_client.h"
+#include "dubbo_codec.h"
+#include "dubbo_conn.h"
+#include "buffer.h"
+#include "histogram.h"
+#include "inflight.h"
+#include "sa.h"
+#include "log.h"
+
+#include "lib/ae/ae.h"
+
+// dubbo ping: 按固定间隔向每个 provider 发送心跳事件, 统计 RTT 分布、丢失与抖动
+// 心跳由 provider 的 IO 线程直接应答, 不进入业务线程池, RTT 只包含网络与 IO 线程的耗时,
+// 与同时段的业务延迟对比即可区分 p99 劣化来自网络还是应用
+
+#define PING_INIT_BUF_SZ 256
+#define PING_EXPIRE_TICK_MS 10
+#define PING_CHECK_STOP_MS 100
+
+struct ping;
+
+// 一个 provider 一条连接, 统计分为全程与当前输出区间两份
+struct ping_target
+{
+    struct ping *ping;
+    const struct dubbo_target *target;
+    union sockaddr_all addr;
+    struct conn conn;
+    bool down; /* 连接失败只在状态变化时输出一次 */
+
+    int64_t sent_n;
+    int64_t recv_n;
+    int64_t lost_n; /* 超时未应答、连接断开或未连接时的探测 */
+    struct hist *rtt; /* 单位 us */
+    double jitter_sum; /* 相邻两次 RTT 之差的绝对值之和 */
+    int64_t jitter_n;
+    uint64_t last_rtt_us;
+    bool has_last;
+
+    int64_t ival_sent_n;
+    int64_t ival_recv_n;
+    int64_t ival_lost_n;
+    struct hist *ival_rtt;
+    double ival_jitter_sum;
+    int64_t ival_jitter_n;
+};
+
+struct ping
+{
+    struct aeEventLoop *el;
+    struct ping_target *targets;
+    int target_n;
+    struct inflight *inflight; /* ud 为 ping_target */
+    struct buffer *frame;      /* 心跳请求帧, 发送时改写 reqid */
+
+    long interval_ms;
+    long report_ms;
+    uint64_t timeout_us;
+    long connect_timeout_ms;
+    int64_t count; /* 每个 provider 的探测次数, 0 为不限 */
+    int64_t probe_n;
+    uint64_t end_us; /* 0 为不限时长 */
+    bool verbos;
+
+    uint64_t start_us;
+    bool stopping; /* 探测已发完或到时长/中断, 等待在途应答 */
+};
+
+static void pt_on_connect(struct conn *c);
+static bool pt_on_frame(struct conn *c, size_t len);
+static void pt_on_frames(struct conn *c, int frame_n);
+static void pt_on_error(struct conn *c, enum conn_err err, int sys_errno);
+
+static const struct conn_ops pt_conn_ops = {
+    .on_connect = pt_on_connect,
+    .on_frame = pt_on_frame,
+    .on_frames = pt_on_frames,
+    .on_error = pt_on_error,
+};
+
+static void pt_lost(struct ping_target *pt, int n)
+{
+    pt->lost_n += n;
+    pt->ival_lost_n += n;
+}
+
+static void pt_close(struct ping_target *pt)
+{
+    conn_close(&pt->conn);
+    // 断开时在途的探测计为丢失
+    pt_lost(pt, inflight_remove_ud(pt->ping->inflight, pt));
+}
+
+// 连接出错只在状态变化时输出一次, 恢复前的重连失败不再输出
+static void pt_down(struct ping_target *pt, enum conn_err err, int sys_errno)
+{
+    if (pt->down)
+    {
+        return;
+    }
+    pt->down = true;
+    if (sys_errno)
+    {
+        LOG_ERROR("%s:%s %s: %s", pt->target->host, pt->target->port, conn_strerror(err), strerror(sys_errno));
+    }
+    else
+    {
+        LOG_ERROR("%s:%s %s", pt->target->host, pt->target->port, conn_strerror(err));
+    }
+}
+
+static void pt_on_error(struct conn *c, enum conn_err err, int sys_errno)
+{
+    struct ping_target *pt = (struct ping_target *)c->ud;
+    pt_down(pt, err, sys_errno);
+    pt_close(pt);
+}
+
+static void pt_on_connect(struct conn *c)
+{
+    struct ping_target *pt = (struct ping_target *)c->ud;
+    if (pt->down)
+    {
+        LOG_INFO("连接 %s:%s 已恢复", pt->target->host, pt->target->port);
+        pt->down = false;
+    }
+}
+
+// 未连接时在下次探测前重试, 连接中的探测计为丢失
+static void pt_connect(struct ping_target *pt)
+{
+    if (!conn_connect(&pt->conn, &pt->addr, pt->ping->connect_timeout_ms))
+    {
+        pt_down(pt, CONN_ERR_CONNECT, errno);
+    }
+}
+
+static void pt_write(struct ping_target *pt)
+{
+    if (!conn_write(&pt->conn))
+    {
+        pt_on_error(&pt->conn, CONN_ERR_WRITE, errno);
+    }
+}
+
+static void pt_on_pong(struct ping_target *pt, const struct inflight_entry *entry)
+{
+    uint64_t rtt_us = now_us() - entry->start_us;
+    pt->recv_n++;
+    pt->ival_recv_n++;
+    hist_record(pt->rtt, rtt_us);
+    hist_record(pt->ival_rtt, rtt_us);
+    if (pt->has_last)
+    {
+        double d = rtt_us > pt->last_rtt_us ? rtt_us - pt->last_rtt_us : pt->last_rtt_us - rtt_us;
+        pt->jitter_sum += d;
+        pt->jitter_n++;
+        pt->ival_jitter_sum += d;
+        pt->ival_jitter_n++;
+    }
+    pt->last_rtt_us = rtt_us;
+    pt->has_last = true;
+    if (pt->ping->verbos)
+    {
+        printf("pong from %s:%s: seq=%" PRId64 " rtt=%.3fms\n", pt->target->host, pt->target->port, (int64_t)entry->tag, rtt_us / 1000.0);
+    }
+}
+
+static bool pt_on_frame(struct conn *c, size_t len)
+{
+    UNUSED(len);
+    struct ping_target *pt = (struct ping_target *)c->ud;
+    struct dubbo_res_view view;
+    if (!dubbo_decode_view(c->rcv_buf, &view))
+    {
+        return false;
+    }
+    if (!view.is_evt)
+    {
+        // 连接上只有心跳, 忽略其他响应
+        return true;
+    }
+    if (view.is_req)
+    {
+        // provider 的心跳请求, 应答追加到 snd_buf, 整批处理完后统一发送
+        if (view.is_twoway)
+        {
+            dubbo_heartbeat_reply(c->snd_buf, view.reqid);
+        }
+        return true;
+    }
+    struct inflight_entry entry;
+    if (inflight_take(pt->ping->inflight, view.reqid, &entry))
+    {
+        pt_on_pong(pt, &entry);
+    }
+    return true;
+}
+
+static void pt_on_frames(struct conn *c, int frame_n)
+{
+    UNUSED(frame_n);
+    if (buf_readable(c->snd_buf) > 0)
+    {
+        pt_write((struct ping_target *)c->ud);
+    }
+}
+
+static void ping_probe(struct ping_target *pt, int64_t seq)
+{
+    struct ping *ping = pt->ping;
+    pt->sent_n++;
+    pt->ival_sent_n++;
+    if (!pt->conn.connected)
+    {
+        pt_lost(pt, 1);
+        if (pt->conn.fd == -1)
+        {
+            pt_connect(pt);
+        }
+        return;
+    }
+
+    int64_t reqid = dubbo_next_reqid();
+    uint64_t now = now_us();
+    // 所有探测超时相同, deadline 按发送顺序单调
+    if (!inflight_put(ping->inflight, reqid, pt, (int)seq, now, now + ping->timeout_us))
+    {
+        // 应答无法区分两次探测, 不发送, 计为丢失
+        LOG_ERROR("重复的 reqid %" PRId64, reqid);
+        pt_lost(pt, 1);
+        return;
+    }
+    const struct buffer *frame = ping->frame;
+    buf_append(pt->conn.snd_buf, buf_peek(frame), buf_readable(frame));
+    dubbo_frame_set_reqid(buf_beginWrite(pt->conn.snd_buf) - buf_readable(frame), reqid);
+    pt_write(pt);
+}
+
+static int ping_on_probe(struct aeEventLoop *el, long long id, void *ud)
+{
+    UNUSED(el);
+    UNUSED(id);
+    struct ping *ping = (struct ping *)ud;
+    if (ping->stopping)
+    {
+        return AE_NOMORE;
+    }
+    ping->probe_n++;
+    for (int i = 0; i < ping->target_n; i++)
+    {
+        ping_probe(&ping->targets[i], ping->probe_n);
+    }
+    if (ping->count > 0 && ping->probe_n >= ping->count)
+    {
+        ping->stopping = true;
+        return AE_NOMORE;
+    }
+    return ping->interval_ms;
+}
+
+static void ping_on_timeout(struct inflight_entry *entry, void *ud)
+{
+    struct ping *ping = (struct ping *)ud;
+    struct ping_target *pt = (struct ping_target *)entry->ud;
+    pt_lost(pt, 1);
+    if (ping->verbos)
+    {
+        printf("timeout from %s:%s: seq=%d\n", pt->target->host, pt->target->port, entry->tag);
+    }
+}
+
+static int ping_on_expire(struct aeEventLoop *el, long long id, void *ud)
+{
+    UNUSED(id);
+    struct ping *ping = (struct ping *)ud;
+    uint64_t now = now_us();
+    inflight_expire(ping->inflight, now, ping_on_timeout, ping);
+    if (!ping->stopping && (stop_signal_raised() || (ping->end_us && now >= ping->end_us)))
+    {
+        // 不再探测, 在途的探测最多再等一个超时, 到期未应答的计为丢失
+        ping->stopping = true;
+    }
+    if (ping->stopping && inflight_count(ping->inflight) == 0)
+    {
+        aeStop(el);
+        return AE_NOMORE;
+    }
+    return PING_EXPIRE_TICK_MS;
+}
+
+static double ping_jitter_ms(double sum, int64_t n)
+{
+    return n ? sum / n / 1000.0 : 0;
+}
+
+static void ping_print(const char *tag, const struct ping_target *pt, int64_t sent_n, int64_t recv_n, int64_t lost_n,
+                       const struct hist *rtt, double jitter_ms)
+{
+    // 在途的探测既不算收到也不算丢失, 丢失率按已有结果的探测计算
+    int64_t done_n = recv_n + lost_n;
+    fprintf(stderr, "\x1B[1;32m[%s]\x1B[0m %s:%s, SENT %" PRId64 ", RECV %" PRId64 ", LOSS %.1f%%, ",
+            tag, pt->target->host, pt->target->port, sent_n, recv_n, done_n ? 100.0 * lost_n / done_n : 0);
+    if (hist_count(rtt) == 0)
+    {
+        // 没有应答时没有 RTT 数据, 不输出 0
+        fprintf(stderr, "RTT MIN -, AVG -, P50 -, P99 -, MAX -, JITTER -\n");
+        return;
+    }
+    fprintf(stderr, "RTT MIN %.3fms, AVG %.3fms, P50 %.3fms, P99 %.3fms, MAX %.3fms, JITTER %.3fms\n",
+            hist_min(rtt) / 1000.0, hist_mean(rtt) / 1000.0, hist_percentile(rtt, 50) / 1000.0,
+            hist_percentile(rtt, 99) / 1000.0, hist_max(rtt) / 1000.0, jitter_ms);
+}
+
+// 按输出间隔逐个 provider 输出区间结果并清零
+static int ping_on_report(struct aeEventLoop *el, long long id, void *ud)
+{
+    UNUSED(el);
+    UNUSED(id);
+    struct ping *ping = (struct ping *)ud;
+    uint64_t now = now_us();
+    fprintf(stderr, "--- %.1fs\n", (now - ping->start_us) / 1e6);
+    for (int i = 0; i < ping->target_n; i++)
+    {
+        struct ping_target *pt = &ping->targets[i];
+        ping_print("PING", pt, pt->ival_sent_n, pt->ival_recv_n, pt->ival_lost_n, pt->ival_rtt,
+                   ping_jitter_ms(pt->ival_jitter_sum, pt->ival_jitter_n));
+        pt->ival_sent_n = 0;
+        pt->ival_recv_n = 0;
+        pt->ival_lost_n = 0;
+        pt->ival_jitter_sum = 0;
+        pt->ival_jitter_n = 0;
+        hist_reset(pt->ival_rtt);
+    }
+    return ping->report_ms;
+}
+
+bool dubbo_ping(struct dubbo_args *args, struct dubbo_async_args *async_args)
+{
+    struct ping ping;
+    memset(&ping, 0, sizeof(ping));
+    ping.el = aeCreateEventLoop(args->target_n + 1024);
+    assert(ping.el);
+    ping.target_n = args->target_n;
+    ping.interval_ms = async_args->ping_interval_ms;
+    ping.timeout_us = (uint64_t)(async_args->req_timeout_ms > 0 ? async_args->req_timeout_ms : args->timeout.tv_sec * 1000) * 1000;
+    ping.connect_timeout_ms = args->timeout.tv_sec * 1000;
+    ping.count = async_args->req_n;
+    ping.verbos = async_args->verbos;
+    ping.inflight = inflight_create(args->target_n * 16);
+
+    struct dubbo_req *hb = dubbo_heartbeat_create();
+    ping.frame = dubbo_encode(hb);
+    dubbo_req_release(hb);
+    assert(ping.frame);
+
+    ping.targets = calloc(ping.target_n, sizeof(*ping.targets));
+    assert(ping.targets);
+    for (int i = 0; i < ping.target_n; i++)
+    {
+        struct ping_target *pt = &ping.targets[i];
+        pt->ping = &ping;
+        pt->target = &args->targets[i];
+        if (!sa_resolve(pt->target->host, &pt->addr))
+        {
+            PANIC("%s DNS解析失败", pt->target->host);
+        }
+        pt->addr.v4.sin_port = htons(atoi(pt->target->port));
+        conn_init(&pt->conn, ping.el, &pt_conn_ops, pt, PING_INIT_BUF_SZ);
+        pt->rtt = hist_create();
+        pt->ival_rtt = hist_create();
+        pt_connect(pt);
+    }
+
+    ping.report_ms = async_args->report_interval_ms > 0 ? async_args->report_interval_ms : 1000;
+    fprintf(stderr, "PING %d provider(s), interval %ldms, timeout %.fms, report every %ldms\n",
+            ping.target_n, ping.interval_ms, ping.timeout_us / 1000.0, ping.report_ms);
+
+    stop_signal_install();
+
+    ping.start_us = now_us();
+    if (async_args->duration_ms > 0)
+    {
+        ping.end_us = ping.start_us + (uint64_t)async_args->duration_ms * 1000;
+    }
+    // 首次探测等一个间隔, 留出建连时间
+    bool ok = AE_ERR != aeCreateTimeEvent(ping.el, ping.interval_ms, ping_on_probe, &ping, NULL) &&
+              AE_ERR != aeCreateTimeEvent(ping.el, PING_EXPIRE_TICK_MS, ping_on_expire, &ping, NULL) &&
+              AE_ERR != aeCreateTimeEvent(ping.el, ping.report_ms, ping_on_report, &ping, NULL);
+    if (ok)
+    {
+        aeMain(ping.el);
+    }
+
+    stop_signal_restore();
+
+    fprintf(stderr, "--- ping statistics, %.2fs\n", (now_us() - ping.start_us) / 1e6);
+    for (int i = 0; i < ping.target_n; i++)
+    {
+        struct ping_target *pt = &ping.targets[i];
+        // 在途的探测已等到应答或超时, 兜底将剩余的计为丢失, 汇总中 SENT = RECV + LOSS
+        pt_close(pt);
+        ping_print("SUMMARY", pt, pt->sent_n, pt->recv_n, pt->lost_n, pt->rtt, ping_jitter_ms(pt->jitter_sum, pt->jitter_n));
+        conn_destroy(&pt->conn);
+        hist_release(pt->rtt);
+        hist_release(pt->ival_rtt);
+    }
+    free(ping.targets);
+    buf_release(ping.frame);
+    inflight_release(ping.inflight);
+    aeDeleteEventLoop(ping.el);
+    return ok;
+}
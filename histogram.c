@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <inttypes.h>
+
+#include "histogram.h"
+
+// 参考 HdrHistogram: 值按最高位划分为桶, 桶内线性划分子桶
+// 桶 0 覆盖 [0, 256) 精度 1, 桶 b 覆盖 [128 << b, 256 << b) 精度 1 << b
+#define HIST_SUB_BITS 7
+#define HIST_SUB_HALF (1 << HIST_SUB_BITS)
+#define HIST_SUB_MASK ((uint64_t)(HIST_SUB_HALF << 1) - 1)
+#define HIST_MAX_BITS 36
+#define HIST_BUCKET_N (HIST_MAX_BITS - HIST_SUB_BITS)
+#define HIST_COUNTS_N ((HIST_BUCKET_N + 1) * HIST_SUB_HALF)
+#define HIST_MAX_VAL (((uint64_t)1 << HIST_MAX_BITS) - 1)
+
+/* 输出 percentile distribution 时每个对半区间的刻度数, 同 HdrHistogram 默认值 */
+#define HIST_TICKS_PER_HALF_DISTANCE 5
+
+struct hist
+{
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t counts[HIST_COUNTS_N];
+};
+
+static inline int hist_index(uint64_t val)
+{
+    int bucket = 63 - __builtin_clzll(val | HIST_SUB_MASK) - HIST_SUB_BITS;
+    int sub = (int)(val >> bucket);
+    return ((bucket + 1) << HIST_SUB_BITS) + (sub - HIST_SUB_HALF);
+}
+
+static inline int hist_index_bucket(int idx)
+{
+    int bucket = (idx >> HIST_SUB_BITS) - 1;
+    return bucket < 0 ? 0 : bucket;
+}
+
+static inline uint64_t hist_index_value(int idx)
+{
+    int bucket = (idx >> HIST_SUB_BITS) - 1;
+    uint64_t sub = (idx & (HIST_SUB_HALF - 1)) + HIST_SUB_HALF;
+    if (bucket < 0)
+    {
+        bucket = 0;
+        sub -= HIST_SUB_HALF;
+    }
+    return sub << bucket;
+}
+
+static inline uint64_t hist_highest_equivalent(int idx)
+{
+    return hist_index_value(idx) + ((uint64_t)1 << hist_index_bucket(idx)) - 1;
+}
+
+static inline uint64_t hist_median_equivalent(int idx)
+{
+    return hist_index_value(idx) + (((uint64_t)1 << hist_index_bucket(idx)) >> 1);
+}
+
+struct hist *hist_create()
+{
+    struct hist *h = malloc(sizeof(*h));
+    assert(h);
+    hist_reset(h);
+    return h;
+}
+
+void hist_release(struct hist *h)
+{
+    free(h);
+}
+
+void hist_reset(struct hist *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void hist_record(struct hist *h, uint64_t val)
+{
+    if (val > HIST_MAX_VAL)
+    {
+        val = HIST_MAX_VAL;
+    }
+    h->counts[hist_index(val)]++;
+    h->total++;
+    if (val < h->min)
+    {
+        h->min = val;
+    }
+    if (val > h->max)
+    {
+        h->max = val;
+    }
+}
+
+void hist_merge(struct hist *dst, const struct hist *src)
+{
+    if (src->total == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < HIST_COUNTS_N; i++)
+    {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    if (src->min < dst->min)
+    {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+uint64_t hist_count(const struct hist *h)
+{
+    return h->total;
+}
+
+uint64_t hist_min(const struct hist *h)
+{
+    return h->total ? h->min : 0;
+}
+
+uint64_t hist_max(const struct hist *h)
+{
+    return h->max;
+}
+
+double hist_mean(const struct hist *h)
+{
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    double sum = 0;
+    for (int i = 0; i < HIST_COUNTS_N; i++)
+    {
+        if (h->counts[i])
+        {
+            sum += (double)hist_median_equivalent(i) * h->counts[i];
+        }
+    }
+    return sum / h->total;
+}
+
+double hist_stddev(const struct hist *h)
+{
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    double mean = hist_mean(h);
+    double sum = 0;
+    for (int i = 0; i < HIST_COUNTS_N; i++)
+    {
+        if (h->counts[i])
+        {
+            double dev = (double)hist_median_equivalent(i) - mean;
+            sum += dev * dev * h->counts[i];
+        }
+    }
+    return sqrt(sum / h->total);
+}
+
+uint64_t hist_percentile(const struct hist *h, double p)
+{
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    if (p > 100)
+    {
+        p = 100;
+    }
+
+    uint64_t target = (uint64_t)ceil(p / 100 * h->total);
+    if (target == 0)
+    {
+        target = 1;
+    }
+
+    uint64_t cum = 0;
+    for (int i = 0; i < HIST_COUNTS_N; i++)
+    {
+        cum += h->counts[i];
+        if (cum >= target)
+        {
+            uint64_t val = hist_highest_equivalent(i);
+            return val < h->max ? val : h->max;
+        }
+    }
+    return h->max;
+}
+
+void hist_print_distribution(const struct hist *h, FILE *out, double scale)
+{
+    fprintf(out, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+    uint64_t cum = 0;
+    double iterate_to = 0;
+    for (int i = 0; i < HIST_COUNTS_N; i++)
+    {
+        if (h->counts[i] == 0)
+        {
+            continue;
+        }
+        cum += h->counts[i];
+        double current = 100.0 * cum / h->total;
+        double val = hist_highest_equivalent(i) / scale;
+
+        // 同一个桶可能跨越多个输出刻度, 逐个输出; 最后一个桶只输出一次, 其后输出 100%
+        while (iterate_to <= current)
+        {
+            double p = iterate_to / 100;
+            fprintf(out, "%12.3f %14.12f %10" PRIu64 " %14.2f\n", val, p, cum, 1 / (1 - p));
+
+            int64_t half_distance = (int64_t)pow(2, (int64_t)(log(100 / (100.0 - iterate_to)) / log(2)) + 1);
+            iterate_to += 100.0 / (HIST_TICKS_PER_HALF_DISTANCE * half_distance);
+            if (cum == h->total)
+            {
+                break;
+            }
+        }
+    }
+    if (h->total)
+    {
+        fprintf(out, "%12.3f %14.12f %10" PRIu64 " %14s\n", h->max / scale, 1.0, h->total, "inf");
+    }
+
+    fprintf(out, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", hist_mean(h) / scale, hist_stddev(h) / scale);
+    fprintf(out, "#[Max     = %12.3f, Total count    = %12" PRIu64 "]\n", h->max / scale, h->total);
+    fprintf(out, "#[Buckets = %12d, SubBuckets     = %12d]\n", HIST_BUCKET_N, HIST_SUB_HALF << 1);
+}
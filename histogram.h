@@ -0,0 +1,31 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// HDR 风格 log-linear 直方图
+// 每个 2 的幂区间线性划分为 128 个子桶, 相对误差 < 1%, 内存固定, 记录 O(1)
+// 取值范围 [0, 2^36), 超出范围的值记为最大值
+
+struct hist;
+
+struct hist *hist_create();
+void hist_release(struct hist *);
+void hist_reset(struct hist *);
+
+void hist_record(struct hist *, uint64_t val);
+void hist_merge(struct hist *dst, const struct hist *src);
+
+uint64_t hist_count(const struct hist *);
+uint64_t hist_min(const struct hist *);
+uint64_t hist_max(const struct hist *);
+double hist_mean(const struct hist *);
+double hist_stddev(const struct hist *);
+// p: [0, 100]
+uint64_t hist_percentile(const struct hist *, double p);
+
+// 以 HdrHistogram percentile distribution 文本格式输出, 值除以 scale 后输出
+void hist_print_distribution(const struct hist *, FILE *out, double scale);
+
+#endif
@@ -0,0 +1,255 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "inflight.h"
+
+#define INFLIGHT_MIN_CAP 64
+
+// 按插入顺序记录 deadline, 已响应的请求在出队时惰性跳过
+struct inflight_deadline
+{
+    int64_t reqid;
+    uint64_t deadline_us;
+};
+
+struct inflight
+{
+    struct inflight_entry *slots;
+    uint32_t cap; /* 2 的幂, 负载因子不超过 0.5 */
+    uint32_t mask;
+    int count;
+
+    struct inflight_deadline *q;
+    uint32_t q_cap;
+    uint32_t q_head;
+    uint32_t q_len;
+};
+
+static inline uint32_t inflight_hash(int64_t reqid)
+{
+    uint64_t x = (uint64_t)reqid;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+static uint32_t round_pow2(uint32_t n)
+{
+    uint32_t cap = INFLIGHT_MIN_CAP;
+    while (cap < n)
+    {
+        cap <<= 1;
+    }
+    return cap;
+}
+
+struct inflight *inflight_create(int cap)
+{
+    struct inflight *t = calloc(1, sizeof(*t));
+    assert(t);
+    t->cap = round_pow2(cap > 0 ? cap * 2 : 0);
+    t->mask = t->cap - 1;
+    t->slots = calloc(t->cap, sizeof(*t->slots));
+    assert(t->slots);
+
+    t->q_cap = t->cap;
+    t->q = calloc(t->q_cap, sizeof(*t->q));
+    assert(t->q);
+    return t;
+}
+
+void inflight_release(struct inflight *t)
+{
+    free(t->slots);
+    free(t->q);
+    free(t);
+}
+
+int inflight_count(const struct inflight *t)
+{
+    return t->count;
+}
+
+static int inflight_find(const struct inflight *t, int64_t reqid)
+{
+    uint32_t i = inflight_hash(reqid) & t->mask;
+    while (t->slots[i].reqid != 0)
+    {
+        if (t->slots[i].reqid == reqid)
+        {
+            return i;
+        }
+        i = (i + 1) & t->mask;
+    }
+    return -1;
+}
+
+// 后移删除: 把后续同一探测链上的元素前移填补空槽, 不需要墓碑
+static void inflight_del(struct inflight *t, uint32_t i)
+{
+    uint32_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & t->mask;
+        if (t->slots[j].reqid == 0)
+        {
+            break;
+        }
+        uint32_t k = inflight_hash(t->slots[j].reqid) & t->mask;
+        // k 位于 (i, j] 区间内 (环形) 时 j 无需移动
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+        {
+            continue;
+        }
+        t->slots[i] = t->slots[j];
+        i = j;
+    }
+    t->slots[i].reqid = 0;
+    t->count--;
+}
+
+static void inflight_insert(struct inflight *t, const struct inflight_entry *e)
+{
+    uint32_t i = inflight_hash(e->reqid) & t->mask;
+    while (t->slots[i].reqid != 0)
+    {
+        i = (i + 1) & t->mask;
+    }
+    t->slots[i] = *e;
+    t->count++;
+}
+
+static void inflight_grow(struct inflight *t)
+{
+    struct inflight_entry *old = t->slots;
+    uint32_t old_cap = t->cap;
+
+    t->cap <<= 1;
+    t->mask = t->cap - 1;
+    t->slots = calloc(t->cap, sizeof(*t->slots));
+    assert(t->slots);
+    t->count = 0;
+
+    for (uint32_t i = 0; i < old_cap; i++)
+    {
+        if (old[i].reqid != 0)
+        {
+            inflight_insert(t, &old[i]);
+        }
+    }
+    free(old);
+}
+
+static void inflight_q_push(struct inflight *t, int64_t reqid, uint64_t deadline_us)
+{
+    if (t->q_len == t->q_cap)
+    {
+        uint32_t ncap = t->q_cap << 1;
+        struct inflight_deadline *nq = malloc(ncap * sizeof(*nq));
+        assert(nq);
+        for (uint32_t i = 0; i < t->q_len; i++)
+        {
+            nq[i] = t->q[(t->q_head + i) % t->q_cap];
+        }
+        free(t->q);
+        t->q = nq;
+        t->q_cap = ncap;
+        t->q_head = 0;
+    }
+    struct inflight_deadline *d = &t->q[(t->q_head + t->q_len) % t->q_cap];
+    d->reqid = reqid;
+    d->deadline_us = deadline_us;
+    t->q_len++;
+}
+
+bool inflight_put(struct inflight *t, int64_t reqid, void *ud, int tag, uint64_t start_us, uint64_t deadline_us)
+{
+    assert(reqid != 0);
+    if (inflight_find(t, reqid) != -1)
+    {
+        return false;
+    }
+    if ((uint32_t)(t->count + 1) * 2 > t->cap)
+    {
+        inflight_grow(t);
+    }
+
+    struct inflight_entry e;
+    e.reqid = reqid;
+    e.ud = ud;
+    e.tag = tag;
+    e.start_us = start_us;
+    e.deadline_us = deadline_us;
+    inflight_insert(t, &e);
+    inflight_q_push(t, reqid, deadline_us);
+    return true;
+}
+
+bool inflight_take(struct inflight *t, int64_t reqid, struct inflight_entry *out)
+{
+    if (reqid == 0)
+    {
+        return false;
+    }
+    int i = inflight_find(t, reqid);
+    if (i == -1)
+    {
+        return false;
+    }
+    if (out)
+    {
+        *out = t->slots[i];
+    }
+    inflight_del(t, i);
+    return true;
+}
+
+int inflight_expire(struct inflight *t, uint64_t now_us, inflight_expire_cb *cb, void *cb_ud)
+{
+    int n = 0;
+    while (t->q_len > 0)
+    {
+        struct inflight_deadline d = t->q[t->q_head];
+        if (d.deadline_us > now_us)
+        {
+            break;
+        }
+        t->q_head = (t->q_head + 1) % t->q_cap;
+        t->q_len--;
+
+        int i = inflight_find(t, d.reqid);
+        if (i == -1 || t->slots[i].deadline_us != d.deadline_us)
+        {
+            // 已响应或已随连接移除
+            continue;
+        }
+        struct inflight_entry e = t->slots[i];
+        inflight_del(t, i);
+        n++;
+        if (cb)
+        {
+            cb(&e, cb_ud);
+        }
+    }
+    return n;
+}
+
+int inflight_remove_ud(struct inflight *t, void *ud)
+{
+    int n = 0;
+    uint32_t i = 0;
+    while (i < t->cap)
+    {
+        if (t->slots[i].reqid != 0 && t->slots[i].ud == ud)
+        {
+            // 后移删除可能把后面的元素移到 i, 需要重新检查 i
+            inflight_del(t, i);
+            n++;
+            continue;
+        }
+        i++;
+    }
+    return n;
+}
@@ -0,0 +1,40 @@
+#ifndef INFLIGHT_H
+#define INFLIGHT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 已发送未响应请求表, 以 reqid 为 key 的开放寻址哈希表 (线性探测, 删除时后移)
+// 同一个表内 deadline 须按插入顺序单调不减, 超时检查只需从插入队列头部扫描
+
+struct inflight_entry
+{
+    int64_t reqid; /* 0 为空槽 */
+    void *ud;
+    int tag; /* 调用方自定义, 如方法下标 */
+    uint64_t start_us;
+    uint64_t deadline_us;
+};
+
+struct inflight;
+
+typedef void inflight_expire_cb(struct inflight_entry *entry, void *ud);
+
+struct inflight *inflight_create(int cap);
+void inflight_release(struct inflight *);
+
+int inflight_count(const struct inflight *);
+
+// reqid 已存在返回 false
+bool inflight_put(struct inflight *, int64_t reqid, void *ud, int tag, uint64_t start_us, uint64_t deadline_us);
+
+// 找到则移除并复制到 out
+bool inflight_take(struct inflight *, int64_t reqid, struct inflight_entry *out);
+
+// 移除所有 deadline <= now 的请求, 逐个回调, 返回移除数量
+int inflight_expire(struct inflight *, uint64_t now_us, inflight_expire_cb *cb, void *cb_ud);
+
+// 移除所有 ud 相同的请求 (连接断开), 返回移除数量
+int inflight_remove_ud(struct inflight *, void *ud);
+
+#endif
@@ -52,11 +52,12 @@ SOFTWARE.
 */
 
 
-static int  the_index = 0;
-static int  the_length = 0;
-static int  the_char = 0;
-static int  the_byte = 0;
-static char* the_input;
+/* thread local: encoder is used by every bench thread */
+static __thread int  the_index = 0;
+static __thread int  the_length = 0;
+static __thread int  the_char = 0;
+static __thread int  the_byte = 0;
+static __thread char* the_input;
 
 
 /*
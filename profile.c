@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <ctype.h>
+
+#include "profile.h"
+#include "log.h"
+
+#define PROFILE_NAME_SZ 32
+#define PROFILE_LINE_SZ 256
+
+struct profile *profile_create(enum profile_kind kind)
+{
+    struct profile *p = calloc(1, sizeof(*p));
+    assert(p);
+    p->kind = kind;
+    return p;
+}
+
+void profile_release(struct profile *p)
+{
+    for (int i = 0; i < p->point_n; i++)
+    {
+        free(p->points[i].name);
+    }
+    free(p->points);
+    free(p);
+}
+
+// 未命名的阶段按到下一点的走势命名, 最后一点之后为保持
+static void profile_auto_name(struct profile *p, int i)
+{
+    struct profile_point *pt = &p->points[i];
+    const char *trend = "hold";
+    if (i + 1 < p->point_n)
+    {
+        const struct profile_point *next = &p->points[i + 1];
+        if (next->t_ms == pt->t_ms)
+        {
+            trend = "step";
+        }
+        else if (next->val > pt->val)
+        {
+            trend = "ramp";
+        }
+        else if (next->val < pt->val)
+        {
+            trend = "decay";
+        }
+    }
+    char name[PROFILE_NAME_SZ];
+    snprintf(name, sizeof(name), "%d-%s", i + 1, trend);
+    free(pt->name);
+    pt->name = strdup(name);
+}
+
+bool profile_add(struct profile *p, long t_ms, double val, const char *name)
+{
+    if (t_ms < 0 || val < 0)
+    {
+        return false;
+    }
+    if (p->point_n > 0 && t_ms < p->points[p->point_n - 1].t_ms)
+    {
+        return false;
+    }
+    if (p->point_n == p->point_cap)
+    {
+        p->point_cap = p->point_cap ? p->point_cap * 2 : 8;
+        p->points = realloc(p->points, p->point_cap * sizeof(*p->points));
+        assert(p->points);
+    }
+
+    struct profile_point *pt = &p->points[p->point_n++];
+    pt->t_ms = t_ms;
+    pt->val = val;
+    pt->name = NULL;
+    pt->auto_name = name == NULL || *name == 0;
+    if (pt->auto_name)
+    {
+        profile_auto_name(p, p->point_n - 1);
+    }
+    else
+    {
+        pt->name = strdup(name);
+    }
+
+    // 前一点的走势取决于新加入的点
+    if (p->point_n > 1 && p->points[p->point_n - 2].auto_name)
+    {
+        profile_auto_name(p, p->point_n - 2);
+    }
+    return true;
+}
+
+double profile_value(const struct profile *p, long t_ms, int *phase)
+{
+    // 二分查找最后一个 t_ms 不晚于当前时刻的点; 阶跃点取后一个值, 即时间相同的点中最后一个
+    // 按秒导入的曲线可能有数万个点, 每个线程每 10ms 查询一次
+    int lo = 0;
+    int hi = p->point_n - 1;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (p->points[mid].t_ms <= t_ms)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    int i = lo;
+    if (phase)
+    {
+        *phase = i;
+    }
+
+    const struct profile_point *a = &p->points[i];
+    if (i + 1 == p->point_n || t_ms <= a->t_ms)
+    {
+        return a->val;
+    }
+    const struct profile_point *b = &p->points[i + 1];
+    return a->val + (b->val - a->val) * (t_ms - a->t_ms) / (b->t_ms - a->t_ms);
+}
+
+const char *profile_phase_name(const struct profile *p, int phase)
+{
+    return p->points[phase].name;
+}
+
+long profile_duration_ms(const struct profile *p)
+{
+    return p->point_n ? p->points[p->point_n - 1].t_ms : 0;
+}
+
+double profile_max(const struct profile *p)
+{
+    double max = 0;
+    for (int i = 0; i < p->point_n; i++)
+    {
+        if (p->points[i].val > max)
+        {
+            max = p->points[i].val;
+        }
+    }
+    return max;
+}
+
+// 每行 "秒,qps", 首行为列名时跳过, 空行与 # 开头的行忽略
+struct profile *profile_load_series(const char *path, double speed)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        LOG_ERROR("打开 QPS 序列 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct profile *p = profile_create(PROFILE_RATE);
+    char line[PROFILE_LINE_SZ];
+    int line_no = 0;
+    double sec0 = 0;
+    double last_sec = 0;
+    double last_qps = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_no++;
+        char *s = line;
+        while (isspace((unsigned char)*s))
+        {
+            s++;
+        }
+        if (*s == 0 || *s == '#')
+        {
+            continue;
+        }
+
+        char *end;
+        double sec = strtod(s, &end);
+        bool ok = end != s;
+        double qps = 0;
+        if (ok)
+        {
+            s = end;
+            while (isspace((unsigned char)*s) || *s == ',' || *s == ';')
+            {
+                s++;
+            }
+            qps = strtod(s, &end);
+            ok = end != s;
+            while (ok && isspace((unsigned char)*end))
+            {
+                end++;
+            }
+            ok = ok && *end == 0;
+        }
+        if (!ok)
+        {
+            if (p->point_n == 0 && line_no == 1)
+            {
+                // 列名
+                continue;
+            }
+            LOG_ERROR("QPS 序列 %s 第 %d 行格式错误, 应为 \"秒,qps\"", path, line_no);
+            goto fail;
+        }
+
+        // 秒可以是 unix 时间戳, 从首行开始计时, 按倍速压缩
+        if (p->point_n == 0)
+        {
+            sec0 = sec;
+        }
+        if (!profile_add(p, (long)((sec - sec0) * 1000 / speed), qps, NULL))
+        {
+            LOG_ERROR("QPS 序列 %s 第 %d 行的秒须不小于上一行且 qps 非负", path, line_no);
+            goto fail;
+        }
+        last_sec = sec;
+        last_qps = qps;
+    }
+
+    if (p->point_n == 0 || profile_max(p) <= 0)
+    {
+        LOG_ERROR("QPS 序列 %s 为空或 qps 全为 0", path);
+        goto fail;
+    }
+    // 每行代表一整秒, 最后一秒保持到结束
+    profile_add(p, (long)((last_sec + 1 - sec0) * 1000 / speed), last_qps, NULL);
+    fclose(fp);
+    return p;
+
+fail:
+    fclose(fp);
+    profile_release(p);
+    return NULL;
+}
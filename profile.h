@@ -0,0 +1,48 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+
+// 负载曲线: 按时间给出目标 qps 或单连接并发的折线
+// 相邻两点之间线性插值, 两点时间相同即阶跃, 最后一点之后保持不变
+// 每个点开始一个阶段, 区间统计按阶段名标记
+
+enum profile_kind
+{
+    PROFILE_RATE, /* 开环目标 qps */
+    PROFILE_CONC, /* 闭环单连接 pipeline 深度, 同 -c */
+};
+
+struct profile_point
+{
+    long t_ms;
+    double val;
+    char *name; /* 从该点开始的阶段名 */
+    bool auto_name;
+};
+
+struct profile
+{
+    enum profile_kind kind;
+    struct profile_point *points;
+    int point_n;
+    int point_cap;
+};
+
+struct profile *profile_create(enum profile_kind kind);
+void profile_release(struct profile *);
+
+// 时间须单调不减, name 为 NULL 时按走势命名, 如 "2-ramp" "3-hold"
+bool profile_add(struct profile *, long t_ms, double val, const char *name);
+
+// t_ms 时刻的目标值, phase 返回所在阶段 (点下标)
+double profile_value(const struct profile *, long t_ms, int *phase);
+const char *profile_phase_name(const struct profile *, int phase);
+
+long profile_duration_ms(const struct profile *);
+double profile_max(const struct profile *);
+
+// 从监控导出的 "秒,qps" CSV 生成开环曲线, 秒内线性插值, 时间除以 speed 压缩; 失败返回 NULL 并输出原因
+struct profile *profile_load_series(const char *path, double speed);
+
+#endif
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+
+#include "replay.h"
+#include "capture.h"
+#include "dubbo_codec.h"
+#include "log.h"
+
+struct replay
+{
+    struct capture_reader *reader;
+    struct replay_frame *frames;
+    uint64_t frame_n;
+    int conn_n;
+};
+
+static int replay_frame_cmp(const void *a, const void *b)
+{
+    const struct replay_frame *x = a;
+    const struct replay_frame *y = b;
+    if (x->off_us != y->off_us)
+    {
+        return x->off_us < y->off_us ? -1 : 1;
+    }
+    // 同一时刻按文件顺序, 映射内存中地址即文件顺序
+    return x->data < y->data ? -1 : (x->data > y->data);
+}
+
+static int u32_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : (x > y);
+}
+
+// 原始连接编号按大小重新编号, 去重后的下标即新编号
+static void replay_renumber_conns(struct replay *rp)
+{
+    uint32_t *ids = malloc(rp->frame_n * sizeof(*ids));
+    assert(ids);
+    for (uint64_t i = 0; i < rp->frame_n; i++)
+    {
+        ids[i] = rp->frames[i].conn;
+    }
+    qsort(ids, rp->frame_n, sizeof(*ids), u32_cmp);
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < rp->frame_n; i++)
+    {
+        if (n == 0 || ids[n - 1] != ids[i])
+        {
+            ids[n++] = ids[i];
+        }
+    }
+    for (uint64_t i = 0; i < rp->frame_n; i++)
+    {
+        uint32_t *p = bsearch(&rp->frames[i].conn, ids, n, sizeof(*ids), u32_cmp);
+        assert(p);
+        rp->frames[i].conn = (uint32_t)(p - ids);
+    }
+    rp->conn_n = (int)n;
+    free(ids);
+}
+
+struct replay *replay_open(const char *path)
+{
+    struct capture_reader *r = capture_reader_open(path);
+    if (r == NULL)
+    {
+        return NULL;
+    }
+
+    struct replay *rp = calloc(1, sizeof(*rp));
+    assert(rp);
+    rp->reader = r;
+
+    uint64_t cap = 0;
+    uint64_t skip_n = 0;
+    struct capture_entry e;
+    const char *frame;
+    while (capture_reader_next(r, &e, &frame))
+    {
+        if (e.dir != CAPTURE_SEND)
+        {
+            continue;
+        }
+        if (!dubbo_frame_is_call(frame, e.len))
+        {
+            skip_n++;
+            continue;
+        }
+        if (rp->frame_n == cap)
+        {
+            cap = cap ? cap * 2 : 1024;
+            rp->frames = realloc(rp->frames, cap * sizeof(*rp->frames));
+            assert(rp->frames);
+        }
+        struct replay_frame *f = &rp->frames[rp->frame_n++];
+        f->off_us = e.ts_us;
+        f->data = frame;
+        f->len = e.len;
+        f->conn = e.conn;
+    }
+    if (skip_n > 0)
+    {
+        LOG_INFO("录制文件 %s 中 %" PRIu64 " 个心跳/单向请求帧不回放", path, skip_n);
+    }
+    if (rp->frame_n == 0)
+    {
+        LOG_ERROR("录制文件 %s 中没有可回放的请求帧", path);
+        replay_close(rp);
+        return NULL;
+    }
+
+    // 各线程的录制块交错写入, 整体按时间排序
+    qsort(rp->frames, rp->frame_n, sizeof(*rp->frames), replay_frame_cmp);
+    uint64_t t0 = rp->frames[0].off_us;
+    for (uint64_t i = 0; i < rp->frame_n; i++)
+    {
+        rp->frames[i].off_us -= t0;
+    }
+    replay_renumber_conns(rp);
+    return rp;
+}
+
+void replay_close(struct replay *rp)
+{
+    free(rp->frames);
+    capture_reader_close(rp->reader);
+    free(rp);
+}
+
+uint64_t replay_frame_n(const struct replay *rp)
+{
+    return rp->frame_n;
+}
+
+int replay_conn_n(const struct replay *rp)
+{
+    return rp->conn_n;
+}
+
+uint64_t replay_span_us(const struct replay *rp)
+{
+    return rp->frames[rp->frame_n - 1].off_us;
+}
+
+const struct replay_frame *replay_frame(const struct replay *rp, uint64_t i)
+{
+    return &rp->frames[i];
+}
@@ -0,0 +1,30 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 流量回放: 取录制文件中发送的请求帧, 按原始发送时间排序
+// 心跳等事件与单向请求不回放; 原始连接按编号重新排为 0 .. conn_n-1, 回放时据此分布到连接上
+
+struct replay_frame
+{
+    uint64_t off_us;  /* 相对首帧的原始发送时间 */
+    const char *data; /* 指向映射的只读内存 */
+    uint32_t len;
+    uint32_t conn;
+};
+
+struct replay;
+
+// 失败返回 NULL 并输出原因
+struct replay *replay_open(const char *path);
+void replay_close(struct replay *);
+
+uint64_t replay_frame_n(const struct replay *);
+int replay_conn_n(const struct replay *);
+// 首帧到末帧的原始时长
+uint64_t replay_span_us(const struct replay *);
+const struct replay_frame *replay_frame(const struct replay *, uint64_t i);
+
+#endif
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <inttypes.h>
+
+#include "report.h"
+
+struct reporter
+{
+    FILE *fp;
+    enum report_fmt fmt;
+    bool header;
+};
+
+struct reporter *reporter_create(const char *path, enum report_fmt fmt)
+{
+    FILE *fp = strcmp(path, "-") == 0 ? stderr : fopen(path, "w");
+    if (fp == NULL)
+    {
+        return NULL;
+    }
+    struct reporter *r = calloc(1, sizeof(*r));
+    assert(r);
+    r->fp = fp;
+    r->fmt = fmt;
+    r->header = false;
+    return r;
+}
+
+void reporter_release(struct reporter *r)
+{
+    if (r->fp != stderr)
+    {
+        fclose(r->fp);
+    }
+    free(r);
+}
+
+bool report_fmt_parse(const char *name, enum report_fmt *fmt)
+{
+    if (strcmp(name, "csv") == 0)
+    {
+        *fmt = REPORT_CSV;
+        return true;
+    }
+    if (strcmp(name, "json") == 0 || strcmp(name, "jsonl") == 0)
+    {
+        *fmt = REPORT_JSONL;
+        return true;
+    }
+    return false;
+}
+
+void reporter_write(struct reporter *r, const struct report_row *row)
+{
+    int64_t done_n = row->ok_n + row->ko_n + row->timeout_n;
+    double qps = row->ival_sec > 0 ? done_n / row->ival_sec : 0;
+    // 延迟单位 ms
+    double p50 = hist_percentile(row->lat, 50) / 1000.0;
+    double p90 = hist_percentile(row->lat, 90) / 1000.0;
+    double p99 = hist_percentile(row->lat, 99) / 1000.0;
+    double p999 = hist_percentile(row->lat, 99.9) / 1000.0;
+    double max = hist_max(row->lat) / 1000.0;
+
+    if (r->fmt == REPORT_CSV)
+    {
+        if (!r->header)
+        {
+            fprintf(r->fp, "ts_ms,elapsed_s,phase,ok,fail,timeout,qps,inflight,p50_ms,p90_ms,p99_ms,p999_ms,max_ms\n");
+            r->header = true;
+        }
+        fprintf(r->fp, "%" PRIu64 ",%.3f,%s,%" PRId64 ",%" PRId64 ",%" PRId64 ",%.1f,%" PRId64 ",%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                row->ts_ms, row->elapsed_sec, row->phase, row->ok_n, row->ko_n, row->timeout_n, qps, row->inflight_n,
+                p50, p90, p99, p999, max);
+    }
+    else
+    {
+        fprintf(r->fp, "{\"ts_ms\":%" PRIu64 ",\"elapsed_s\":%.3f,\"phase\":\"%s\",\"ok\":%" PRId64 ",\"fail\":%" PRId64 ",\"timeout\":%" PRId64
+                       ",\"qps\":%.1f,\"inflight\":%" PRId64 ",\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"p999_ms\":%.3f,\"max_ms\":%.3f}\n",
+                row->ts_ms, row->elapsed_sec, row->phase, row->ok_n, row->ko_n, row->timeout_n, qps, row->inflight_n,
+                p50, p90, p99, p999, max);
+    }
+    // 便于 tail -f 实时观察
+    fflush(r->fp);
+}
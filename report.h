@@ -0,0 +1,41 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "histogram.h"
+
+// 压测过程中按固定间隔输出的时间序列, 每行一个区间, CSV 或 JSON lines
+
+enum report_fmt
+{
+    REPORT_CSV,
+    REPORT_JSONL,
+};
+
+struct report_row
+{
+    uint64_t ts_ms;     /* 区间结束时刻, unix 时间戳 */
+    double elapsed_sec; /* 距压测开始 */
+    double ival_sec;    /* 区间实际长度 */
+    const char *phase;
+    int64_t ok_n;
+    int64_t ko_n;
+    int64_t timeout_n;
+    int64_t inflight_n;
+    const struct hist *lat; /* 区间内延迟, 单位 us */
+};
+
+struct reporter;
+
+// path 为 "-" 时输出到标准错误, 打开失败返回 NULL
+struct reporter *reporter_create(const char *path, enum report_fmt fmt);
+void reporter_release(struct reporter *);
+
+void reporter_write(struct reporter *, const struct report_row *);
+
+// "csv" / "json", 非法返回 false
+bool report_fmt_parse(const char *name, enum report_fmt *fmt);
+
+#endif
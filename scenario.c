@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "scenario.h"
+#include "log.h"
+
+#include "lib/cJSON.h"
+
+static char *read_file(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        LOG_ERROR("打开 %s 失败: %s", path, strerror(errno));
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long sz = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = malloc(sz + 1);
+    assert(data);
+    if (fread(data, 1, sz, fp) != (size_t)sz)
+    {
+        LOG_ERROR("读取 %s 失败", path);
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    data[sz] = 0;
+    fclose(fp);
+    return data;
+}
+
+// JSON 值转为 JSON 文本, 字符串视为已是 JSON 文本
+static char *json_text(const cJSON *item)
+{
+    if (cJSON_IsString(item))
+    {
+        return strdup(item->valuestring);
+    }
+    return cJSON_PrintUnformatted(item);
+}
+
+static bool scenario_parse_item(const cJSON *item, struct dubbo_method *m, int idx)
+{
+    const cJSON *method = cJSON_GetObjectItem(item, "method");
+    const cJSON *args = cJSON_GetObjectItem(item, "args");
+    const cJSON *attach = cJSON_GetObjectItem(item, "attach");
+    const cJSON *weight = cJSON_GetObjectItem(item, "weight");
+
+    if (!cJSON_IsString(method) || strrchr(method->valuestring, '.') == NULL)
+    {
+        LOG_ERROR("场景第 %d 项缺少 method (service.method)", idx);
+        return false;
+    }
+    if (args == NULL)
+    {
+        LOG_ERROR("场景第 %d 项缺少 args", idx);
+        return false;
+    }
+
+    m->service = strdup(method->valuestring);
+    char *dot = strrchr(m->service, '.');
+    *dot = 0;
+    m->method = dot + 1;
+    m->args = json_text(args);
+    m->attach = attach ? json_text(attach) : strdup("{}");
+    m->weight = 1;
+    if (weight)
+    {
+        if (!cJSON_IsNumber(weight) || weight->valuedouble < 0)
+        {
+            LOG_ERROR("场景第 %d 项 weight 非法", idx);
+            return false;
+        }
+        m->weight = weight->valuedouble;
+    }
+
+    // 提前校验, 避免压测开始后才编码失败; 参数模板在加载数据集后以首行渲染校验
+    bool args_ok = strstr(m->args, "{{") != NULL;
+    if (!args_ok)
+    {
+        cJSON *json_args = cJSON_Parse(m->args);
+        args_ok = json_args && (cJSON_IsObject(json_args) || cJSON_IsArray(json_args));
+        cJSON_Delete(json_args);
+    }
+    cJSON *json_attach = cJSON_Parse(m->attach);
+    bool attach_ok = json_attach && cJSON_IsObject(json_attach);
+    cJSON_Delete(json_attach);
+    if (!args_ok || !attach_ok)
+    {
+        LOG_ERROR("场景第 %d 项 args 须为 JSON 数组或对象, attach 须为 JSON 对象", idx);
+        return false;
+    }
+    return true;
+}
+
+struct dubbo_method *scenario_load(const char *path, int *method_n)
+{
+    char *data = read_file(path);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+    cJSON *root = cJSON_Parse(data);
+    free(data);
+    if (!cJSON_IsArray(root) || cJSON_GetArraySize(root) == 0)
+    {
+        LOG_ERROR("场景文件 %s 须为非空 JSON 数组", path);
+        cJSON_Delete(root);
+        return NULL;
+    }
+
+    int n = cJSON_GetArraySize(root);
+    struct dubbo_method *methods = calloc(n, sizeof(*methods));
+    assert(methods);
+    double weight_sum = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (!scenario_parse_item(cJSON_GetArrayItem(root, i), &methods[i], i))
+        {
+            cJSON_Delete(root);
+            scenario_release(methods, n);
+            return NULL;
+        }
+        weight_sum += methods[i].weight;
+    }
+    cJSON_Delete(root);
+
+    if (weight_sum <= 0)
+    {
+        LOG_ERROR("场景文件 %s 权重之和须大于 0", path);
+        scenario_release(methods, n);
+        return NULL;
+    }
+    *method_n = n;
+    return methods;
+}
+
+void scenario_release(struct dubbo_method *methods, int method_n)
+{
+    for (int i = 0; i < method_n; i++)
+    {
+        // method 指向 service 内部
+        free(methods[i].service);
+        free(methods[i].args);
+        free(methods[i].attach);
+    }
+    free(methods);
+}
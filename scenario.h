@@ -0,0 +1,14 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "dubbo_client.h"
+
+// 场景文件: JSON 数组, 每项为一个方法及其权重
+// [{"method": "com.foo.UserService.getUserById", "args": [1], "attach": {}, "weight": 70}, ...]
+// args 与 attach 可以是 JSON 值, 也可以是 JSON 文本字符串; attach 默认 {}, weight 默认 1
+
+// 失败返回 NULL 并输出原因
+struct dubbo_method *scenario_load(const char *path, int *method_n);
+void scenario_release(struct dubbo_method *methods, int method_n);
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "topk.h"
+
+struct topk
+{
+    struct topk_item *items;
+    int n;
+    int cap;
+};
+
+struct topk *topk_create(int k)
+{
+    struct topk *t = calloc(1, sizeof(*t));
+    assert(t);
+    t->cap = k;
+    t->items = calloc(k, sizeof(*t->items));
+    assert(t->items);
+    return t;
+}
+
+void topk_release(struct topk *t)
+{
+    free(t->items);
+    free(t);
+}
+
+void topk_add(struct topk *t, const char *key, size_t len, int64_t n)
+{
+    if (len >= TOPK_KEY_MAX)
+    {
+        len = TOPK_KEY_MAX - 1;
+    }
+
+    int min = -1;
+    for (int i = 0; i < t->n; i++)
+    {
+        struct topk_item *it = &t->items[i];
+        if (strncmp(it->key, key, len) == 0 && it->key[len] == 0)
+        {
+            it->count += n;
+            return;
+        }
+        if (min == -1 || it->count < t->items[min].count)
+        {
+            min = i;
+        }
+    }
+
+    struct topk_item *it;
+    if (t->n < t->cap)
+    {
+        it = &t->items[t->n++];
+        it->count = 0;
+        it->err = 0;
+    }
+    else
+    {
+        // 替换计数最小的一项, 新 key 的计数至多偏大 err
+        it = &t->items[min];
+        it->err = it->count;
+    }
+    memcpy(it->key, key, len);
+    it->key[len] = 0;
+    it->count += n;
+}
+
+void topk_merge(struct topk *dst, const struct topk *src)
+{
+    for (int i = 0; i < src->n; i++)
+    {
+        const struct topk_item *it = &src->items[i];
+        topk_add(dst, it->key, strlen(it->key), it->count);
+    }
+}
+
+static int topk_cmp(const void *a, const void *b)
+{
+    const struct topk_item *x = a;
+    const struct topk_item *y = b;
+    return x->count < y->count ? 1 : (x->count > y->count ? -1 : 0);
+}
+
+int topk_sorted(struct topk *t, const struct topk_item **items)
+{
+    qsort(t->items, t->n, sizeof(*t->items), topk_cmp);
+    *items = t->items;
+    return t->n;
+}
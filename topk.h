@@ -0,0 +1,30 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Space-Saving 算法统计出现最多的 K 个字符串, 内存固定
+// 表满时新 key 替换计数最小的一项并继承其计数, 计数可能偏大, 偏大上限记为 err
+
+#define TOPK_KEY_MAX 96
+
+struct topk_item
+{
+    char key[TOPK_KEY_MAX]; /* 超长截断 */
+    int64_t count;
+    int64_t err;
+};
+
+struct topk;
+
+struct topk *topk_create(int k);
+void topk_release(struct topk *);
+
+void topk_add(struct topk *, const char *key, size_t len, int64_t n);
+void topk_merge(struct topk *dst, const struct topk *src);
+
+// 按计数降序排列, 返回项数, items 指向内部数组
+int topk_sorted(struct topk *, const struct topk_item **items);
+
+#endif